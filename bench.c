@@ -0,0 +1,477 @@
+/*
+ * bench.c
+ * microbenchmarks for the vmm and loader hot paths of fos os
+ * Joshua Castelli/Nathan Helmig
+ *
+ * usage: FOSbench [-p pageSizes] [-m mainSizes] [-s secSizes] [-n procCounts] [-i iterations]
+ *    -p, -m, -s and -n take a comma separated list (e.g. -p 1,8,64)
+ *    every combination of the lists is benchmarked
+ *    results are written to stdout as one JSON document
+ */
+
+/**************************************************************
+	#includes
+**************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "fos-kernel2.h"
+#include "computer2.h"
+#include "vmm.h"
+#include "proctab.h"
+#include "fex.h"
+#include "hrtime.h"
+
+/**************************************************************
+	#defines
+**************************************************************/
+#define BENCH_MAX_LIST 16
+#define BENCH_MAX_RESULTS 16
+
+/**************************************************************
+	Types
+**************************************************************/
+typedef struct {
+	int pageSize;
+	int mainSize;
+	int secSize;
+	int procs;
+	long iterations;
+} BenchConfig;
+
+typedef struct {
+	char *name;
+	int skipped;
+	long ops;
+	long long ns;
+	long words;         // words moved, for throughput benchmarks
+} BenchResult;
+
+/**************************************************************
+	Prototypes
+**************************************************************/
+int parseList(char *arg, int list[]);
+void benchSetup(BenchConfig *c);
+int benchLoadProcs(BenchConfig *c);
+void benchEvictAll();
+void benchTranslationHit(BenchConfig *c, BenchResult *r);
+void benchFaultFreeFrame(BenchConfig *c, BenchResult *r);
+void benchFaultEvict(BenchConfig *c, BenchResult *r, int write);
+void benchProcessTerm(BenchConfig *c, BenchResult *r);
+void benchLoadProgFile(BenchConfig *c, BenchResult *r);
+void benchPageCopy(BenchConfig *c, BenchResult *r, int bulk);
+void benchGuestCopy(BenchConfig *c, BenchResult *r, int bulk);
+void benchStackPushPop(BenchConfig *c, BenchResult *r);
+void printResults(BenchConfig *c, BenchResult r[], int n, int first);
+
+
+/**************************************************************
+	Functions
+**************************************************************/
+
+
+/****Parse List************************************************
+	parseList splits "1,8,64" into list, returns the count
+**************************************************************/
+int parseList(char *arg, int list[]){
+	int n = 0;
+	for(char *tok = strtok(arg, ","); tok != NULL && n < BENCH_MAX_LIST; tok = strtok(NULL, ",")){
+		list[n++] = atoi(tok);
+	}
+	return n;
+}
+
+/****Bench Setup***********************************************
+	creates memory and a fresh page table for one configuration,
+	freeing those of the last one (the kernel makes new memory
+	and leaves the old alone, see vmmKernelSize)
+**************************************************************/
+void benchSetup(BenchConfig *c){
+	free(mainMem);
+	free(secMem);
+	createMainMem(c->mainSize);
+	createSecMem(c->secSize);
+	initFOSKernel1(c->pageSize);
+	free(pageTable);
+	initVMM();
+	procTableInit();
+	cpu.pid = 0;
+	clock = 0;
+}
+
+/****Bench Load Processes**************************************
+	registers c->procs processes (pids 1..procs) and records them
+	in the page table,
+	splitting secondary memory (less the zero page) evenly; the
+	pages hold zeros
+	return: pages per process
+**************************************************************/
+int benchLoadProcs(BenchConfig *c){
+	int pagesPerProc = (getNumSecPages() - 1) / c->procs;
+
+	for(int p = 1; p <= c->procs; p++){
+		Process *proc = procTableAlloc();
+		procTableAdd(proc, p);
+		for(int vPage = 0; vPage < pagesPerProc; vPage++){
+			int sPage = pageTableGetFreeSecPage(*proc);
+			pageTableLoadProcessToSecFrame(sPage, p);
+			pageTable[sPage].vPage = vPage;
+		}
+	}
+	return pagesPerProc;
+}
+
+/****Bench Evict All*******************************************
+	marks every page non-resident without writing anything back
+**************************************************************/
+void benchEvictAll(){
+	vmmStackDrop();
+	for(int i = 0; i < getNumSecPages(); i++){
+		pageTable[i].mainPageFrame = -1;
+		pageTable[i].dirty = FALSE;
+	}
+	pageTableRecount();
+}
+
+/****Translation Hit*******************************************
+	reads within one resident page of the last loaded process
+**************************************************************/
+void benchTranslationHit(BenchConfig *c, BenchResult *r){
+	benchSetup(c);
+	benchLoadProcs(c);
+	cpu.pid = c->procs;
+	readWordFromMainMem(0);
+
+	long long start = hrtimeNow();
+	for(long i = 0; i < c->iterations; i++){
+		readWordFromMainMem(i % c->pageSize);
+	}
+	r->ns = hrtimeNow() - start;
+	r->ops = c->iterations;
+}
+
+/****Fault With Free Frame*************************************
+	faults pages of every process into empty main page frames;
+	main memory is emptied (untimed) whenever it fills
+**************************************************************/
+void benchFaultFreeFrame(BenchConfig *c, BenchResult *r){
+	benchSetup(c);
+	int pagesPerProc = benchLoadProcs(c);
+	int frames = getNumMainPages();
+	if(frames > pagesPerProc * c->procs) frames = pagesPerProc * c->procs;
+
+	r->ops = 0;
+	r->ns = 0;
+	while(r->ops < c->iterations && frames > 0){
+		benchEvictAll();
+		long long start = hrtimeNow();
+		for(int k = 0; k < frames; k++){
+			cpu.pid = 1 + k % c->procs;
+			readWordFromMainMem((WORD)(k / c->procs) * c->pageSize);
+		}
+		r->ns += hrtimeNow() - start;
+		r->ops += frames;
+	}
+}
+
+/****Fault With Eviction***************************************
+	cycles through one more page than fits in main memory so that,
+	under LRU, every access faults and evicts; writing makes every
+	victim dirty
+**************************************************************/
+void benchFaultEvict(BenchConfig *c, BenchResult *r, int write){
+	benchSetup(c);
+	int pagesPerProc = benchLoadProcs(c);
+	int pages = getNumMainPages() + 1;
+	if(pages > pagesPerProc * c->procs){
+		r->skipped = TRUE;
+		return;
+	}
+
+	/* fill main memory first */
+	for(int k = 0; k < pages - 1; k++){
+		cpu.pid = 1 + k % c->procs;
+		clock++;
+		if(write) writeWordToMainMem((WORD)(k / c->procs) * c->pageSize, k);
+		else readWordFromMainMem((WORD)(k / c->procs) * c->pageSize);
+	}
+
+	long long start = hrtimeNow();
+	for(long i = 0; i < c->iterations; i++){
+		int k = (pages - 1 + i) % pages;
+		cpu.pid = 1 + k % c->procs;
+		clock++;
+		if(write) writeWordToMainMem((WORD)(k / c->procs) * c->pageSize, i);
+		else readWordFromMainMem((WORD)(k / c->procs) * c->pageSize);
+	}
+	r->ns = hrtimeNow() - start;
+	r->ops = c->iterations;
+}
+
+/****Process Termination***************************************
+	tears down every loaded process with pageTableProcessTerm and
+	frees its process table entry
+**************************************************************/
+void benchProcessTerm(BenchConfig *c, BenchResult *r){
+	benchSetup(c);
+	long reps = 1 + c->iterations / ((long)c->procs * getNumSecPages());
+
+	r->ops = 0;
+	r->ns = 0;
+	for(long rep = 0; rep < reps; rep++){
+		benchLoadProcs(c);
+		long long start = hrtimeNow();
+		for(int p = 1; p <= c->procs; p++){
+			pageTableProcessTerm(p);
+			procTableFree(procTableFind(p));
+		}
+		r->ns += hrtimeNow() - start;
+		r->ops += c->procs;
+	}
+}
+
+/****Load Program File*****************************************
+	loads a generated program that fills secondary memory the way
+	loadFile does (loadAndRun.c, which has its own main and is not
+	linked here): the kernel's openProgFile sets up the entry,
+	fexParseFile and fexVerify read and check the file, and the
+	words go to frames from pageTableReserveSecPages, as in
+	writeImage and loadImage; reports words loaded
+**************************************************************/
+void benchLoadProgFile(BenchConfig *c, BenchResult *r){
+	char fileName[] = "/tmp/fosbenchXXXXXX";
+	int fd = mkstemp(fileName);
+	if(fd == -1){
+		r->skipped = TRUE;
+		return;
+	}
+
+	benchSetup(c);
+	int codeSize = (getNumSecPages() - 1) * c->pageSize;
+	FILE *out = fdopen(fd, "w");
+	fprintf(out, "fex2\n0000 stack\n0000 heap\n%04d code\n", codeSize);
+	for(int addr = 0; addr < codeSize - 1; addr++){
+		fprintf(out, "%04d x...\n", addr);
+	}
+	fprintf(out, "%04d e...\n", codeSize - 1);
+	fclose(out);
+
+	long reps = 1 + c->iterations / (codeSize > 0 ? codeSize : 1);
+	int pages = (codeSize + c->pageSize - 1) / c->pageSize;
+	int *frames = malloc((pages + 1) * sizeof(int));
+
+	r->ops = 0;
+	r->ns = 0;
+	r->words = 0;
+	for(long rep = 0; rep < reps && codeSize > 0 && frames != NULL; rep++){
+		FexImage image;
+		long long start = hrtimeNow();
+		Process *proc = procTableAlloc();
+		FILE *progFile = openProgFile(fileName, proc);
+		if(progFile != NULL) fclose(progFile);
+		if(progFile == NULL || fexParseFile(fileName, &image) != 0){
+			procTableFree(proc);
+			r->skipped = TRUE;
+			break;
+		}
+		if(fexVerify(&image) != 0 || pageTableReserveSecPages(pages, frames) != 0){
+			fexFree(&image);
+			procTableFree(proc);
+			r->skipped = TRUE;
+			break;
+		}
+		procTableAdd(proc, 1);
+		for(int vPage = 0; vPage < pages; vPage++){
+			int base = frames[vPage] * c->pageSize;
+			for(int w = 0; w < c->pageSize; w++){
+				int a = vPage * c->pageSize + w;
+				if(a < image.size && image.kind[a] == FEX_INST){
+					writeInstToSec(base + w, image.inst[a]);
+				}else{
+					writeDataToSec(base + w, a < image.size ? image.data[a] : 0);
+				}
+			}
+		}
+		pageTableCommitSecPages(frames, pages, 1);
+		fexFree(&image);
+		r->ns += hrtimeNow() - start;
+		r->ops++;
+		r->words += codeSize;
+		pageTableProcessTerm(proc->pid);
+		procTableFree(proc);
+	}
+	free(frames);
+	unlink(fileName);
+}
+
+/****Page Copy***********************************************
+	secondary-to-main page copies through the kernel's
+	copySecToMain, or through the bulk vmmCopySecToMain
+**************************************************************/
+void benchPageCopy(BenchConfig *c, BenchResult *r, int bulk){
+	benchSetup(c);
+	int sPages = getNumSecPages();
+	int mPages = getNumMainPages();
+
+	long long start = hrtimeNow();
+	for(long i = 0; i < c->iterations; i++){
+		int s = (i % sPages) * c->pageSize;
+		int m = (i % mPages) * c->pageSize;
+		if(bulk) vmmCopySecToMain(s, m, c->pageSize);
+		else copySecToMain(s, m, c->pageSize);
+	}
+	r->ns = hrtimeNow() - start;
+	r->ops = c->iterations;
+	r->words = c->iterations * c->pageSize;
+}
+
+/****Guest Copy**********************************************
+	a guest copying half of its resident image to the other half,
+	one read/write pair per word or one vmmBlockCopy (the BMOV path)
+**************************************************************/
+void benchGuestCopy(BenchConfig *c, BenchResult *r, int bulk){
+	benchSetup(c);
+	int pagesPerProc = benchLoadProcs(c);
+	int pages = getNumMainPages() < pagesPerProc ? getNumMainPages() : pagesPerProc;
+	WORD half = (WORD)(pages / 2) * c->pageSize;
+	if(half == 0){
+		r->skipped = TRUE;
+		return;
+	}
+	cpu.pid = 1;
+	for(WORD v = 0; v < 2 * half; v += c->pageSize){
+		readWordFromMainMem(v);
+	}
+
+	long reps = 1 + c->iterations / half;
+	long long start = hrtimeNow();
+	for(long rep = 0; rep < reps; rep++){
+		if(bulk){
+			vmmBlockCopy(0, half, half);
+		}else{
+			for(WORD v = 0; v < half; v++){
+				writeWordToMainMem(half + v, readWordFromMainMem(v));
+			}
+		}
+	}
+	r->ns = hrtimeNow() - start;
+	r->ops = reps;
+	r->words = reps * half;
+}
+
+/****Stack Push Pop******************************************
+	a guest pushing eight words and popping them again (calls and
+	returns look the same to memory), all within its first stack page
+**************************************************************/
+void benchStackPushPop(BenchConfig *c, BenchResult *r){
+	benchSetup(c);
+	benchLoadProcs(c);
+	Process *proc = procTableFind(1);
+	proc->stackSize = c->pageSize;
+	cpu.pid = 1;
+	cpu.sp = 0;
+	push(0);
+	pop();
+
+	long long start = hrtimeNow();
+	for(long i = 0; i < c->iterations; i += 16){
+		for(int k = 0; k < 8; k++){
+			push(k);
+			if(cpu.sp == c->pageSize) cpu.sp = 0;
+		}
+		for(int k = 0; k < 8; k++){
+			if(cpu.sp == 0) cpu.sp = c->pageSize;
+			pop();
+		}
+	}
+	r->ns = hrtimeNow() - start;
+	r->ops = (c->iterations + 15) / 16 * 16;
+}
+
+/****Print Results*********************************************
+	one JSON object per configuration
+**************************************************************/
+void printResults(BenchConfig *c, BenchResult r[], int n, int first){
+	if(!first) printf(",\n");
+	printf("    {\"pageSize\": %d, \"mainSize\": %d, \"secSize\": %d, \"procs\": %d, \"iterations\": %ld,\n",
+	       c->pageSize, c->mainSize, c->secSize, c->procs, c->iterations);
+	printf("     \"results\": [\n");
+	for(int i = 0; i < n; i++){
+		printf("       {\"name\": \"%s\", ", r[i].name);
+		if(r[i].skipped || r[i].ops == 0){
+			printf("\"skipped\": true}");
+		}else{
+			double ns = r[i].ns > 0 ? (double)r[i].ns : 1.0;
+			printf("\"ops\": %ld, \"ns\": %lld, \"ns_per_op\": %.2f, \"ops_per_sec\": %.0f",
+			       r[i].ops, r[i].ns, ns / r[i].ops, r[i].ops * 1e9 / ns);
+			if(r[i].words > 0) printf(", \"words_per_sec\": %.0f", r[i].words * 1e9 / ns);
+			printf("}");
+		}
+		printf("%s\n", i < n - 1 ? "," : "");
+	}
+	printf("     ]}");
+}
+
+/****MAIN******************************************************
+	MAIN FUNCTION - runs every benchmark for every configuration
+**************************************************************/
+int main(int argc, char* argv[]){
+	int pageSizes[BENCH_MAX_LIST] = {8}, nPageSizes = 1;
+	int mainSizes[BENCH_MAX_LIST] = {256}, nMainSizes = 1;
+	int secSizes[BENCH_MAX_LIST] = {4096}, nSecSizes = 1;
+	int procCounts[BENCH_MAX_LIST] = {4}, nProcCounts = 1;
+	long iterations = 100000;
+
+	for(int i = 1; i + 1 < argc; i += 2){
+		if(strcmp(argv[i], "-p") == 0){
+			nPageSizes = parseList(argv[i + 1], pageSizes);
+		}else if(strcmp(argv[i], "-m") == 0){
+			nMainSizes = parseList(argv[i + 1], mainSizes);
+		}else if(strcmp(argv[i], "-s") == 0){
+			nSecSizes = parseList(argv[i + 1], secSizes);
+		}else if(strcmp(argv[i], "-n") == 0){
+			nProcCounts = parseList(argv[i + 1], procCounts);
+		}else if(strcmp(argv[i], "-i") == 0){
+			iterations = atol(argv[i + 1]);
+		}else{
+			fprintf(stderr, "Usage: %s [-p pageSizes] [-m mainSizes] [-s secSizes] [-n procCounts] [-i iterations]\n", argv[0]);
+			exit(1);
+		}
+	}
+
+	int printed = 0;
+	printf("{\"benchmark\": \"fos-vmm\", \"runs\": [\n");
+	for(int p = 0; p < nPageSizes; p++)
+	for(int m = 0; m < nMainSizes; m++)
+	for(int s = 0; s < nSecSizes; s++)
+	for(int n = 0; n < nProcCounts; n++){
+		BenchConfig c = {pageSizes[p], mainSizes[m], secSizes[s], procCounts[n], iterations};
+		BenchResult r[BENCH_MAX_RESULTS];
+		int nr = 0;
+
+		if(c.pageSize <= 0 || c.procs <= 0 || c.secSize / c.pageSize < c.procs || c.mainSize < c.pageSize){
+			fprintf(stderr, "skipping invalid configuration p=%d m=%d s=%d n=%d\n", c.pageSize, c.mainSize, c.secSize, c.procs);
+			continue;
+		}
+
+		memset(r, 0, sizeof(r));
+		r[nr].name = "translation_hit";      benchTranslationHit(&c, &r[nr++]);
+		r[nr].name = "fault_free_frame";     benchFaultFreeFrame(&c, &r[nr++]);
+		r[nr].name = "fault_clean_evict";    benchFaultEvict(&c, &r[nr++], FALSE);
+		r[nr].name = "fault_dirty_evict";    benchFaultEvict(&c, &r[nr++], TRUE);
+		r[nr].name = "process_term";         benchProcessTerm(&c, &r[nr++]);
+		r[nr].name = "load_prog_file";       benchLoadProgFile(&c, &r[nr++]);
+		r[nr].name = "page_copy_kernel";     benchPageCopy(&c, &r[nr++], FALSE);
+		r[nr].name = "page_copy_bulk";       benchPageCopy(&c, &r[nr++], TRUE);
+		r[nr].name = "guest_copy_per_word";  benchGuestCopy(&c, &r[nr++], FALSE);
+		r[nr].name = "guest_copy_block";     benchGuestCopy(&c, &r[nr++], TRUE);
+		r[nr].name = "stack_push_pop";       benchStackPushPop(&c, &r[nr++]);
+
+		printResults(&c, r, nr, printed++ == 0);
+	}
+	printf("\n]}\n");
+
+	return 0;
+}
@@ -0,0 +1,291 @@
+/*
+ * cache.c
+ * set-associative instruction and data cache model for fos os
+ * Joshua Castelli/Nathan Helmig
+ */
+
+#include "cache.h"
+#include "cost.h"
+#include "tier.h"
+#include "proctab.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * CacheLine - one line of a set
+ *    stamp    access time (LRU) or fill time (FIFO) of the line
+ */
+typedef struct {
+	WORD tag;
+	long stamp;
+	int valid;
+	int dirty;
+} CacheLine;
+
+/*
+ * Cache - one cache; set s is lines[s*assoc .. s*assoc+assoc-1]
+ */
+typedef struct {
+	CacheConfig config;
+	int sets;
+	CacheLine *lines;
+} Cache;
+
+/*
+ * CacheRec - what one process did in the caches
+ */
+typedef struct {
+	int pid;
+	long accesses[2];
+	long misses[2];
+	long writeBacks;
+	long missCycles;
+} CacheRec;
+
+int cacheEnabled = 0;
+
+static char *cacheNames[2] = {"I-cache", "D-cache"};
+static char *policyNames[3] = {"lru", "fifo", "random"};
+
+static Cache caches[2] = {
+	{{256, 2, 4, CACHE_LRU}, 0, NULL},      // I-cache
+	{{512, 4, 4, CACHE_LRU}, 0, NULL}       // D-cache
+};
+static long cacheTime = 0;
+static unsigned long cacheSeed = 1;
+
+static CacheRec *cacheRecs = NULL;
+static int nCacheRecs = 0;
+static int capCacheRecs = 0;
+static int lastCacheRec = -1;
+
+/*================================================================================*/
+/*
+ * cacheGetRec
+ *    the cache record of pid, created on first use
+ */
+static CacheRec* cacheGetRec(int pid){
+	if(lastCacheRec != -1 && cacheRecs[lastCacheRec].pid == pid) return &cacheRecs[lastCacheRec];
+	ProcEntry *entry = (ProcEntry*)procTableFind(pid);
+	if(entry != NULL && entry->cacheRec != -1){
+		lastCacheRec = entry->cacheRec;
+		return &cacheRecs[lastCacheRec];
+	}
+	for(int i = 0; i < nCacheRecs; i++){
+		if(cacheRecs[i].pid == pid){
+			if(entry != NULL) entry->cacheRec = i;
+			lastCacheRec = i;
+			return &cacheRecs[i];
+		}
+	}
+	if(nCacheRecs == capCacheRecs){
+		capCacheRecs = capCacheRecs ? capCacheRecs * 2 : 16;
+		cacheRecs = realloc(cacheRecs, capCacheRecs * sizeof(CacheRec));
+		if(cacheRecs == NULL){
+			fprintf(stderr, "CACHE: out of memory\n");
+			exit(1);
+		}
+	}
+	memset(&cacheRecs[nCacheRecs], 0, sizeof(CacheRec));
+	cacheRecs[nCacheRecs].pid = pid;
+	if(entry != NULL) entry->cacheRec = nCacheRecs;
+	lastCacheRec = nCacheRecs;
+	return &cacheRecs[nCacheRecs++];
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * cacheEmpty
+ *    (re)allocate the lines of cache c, all invalid
+ *    return 0 success, -1 out of memory
+ */
+static int cacheEmpty(Cache *c){
+	free(c->lines);
+	c->sets = c->config.size / (c->config.assoc * c->config.line);
+	c->lines = calloc(c->sets * c->config.assoc, sizeof(CacheLine));
+	if(c->lines == NULL){
+		fprintf(stderr, "CACHE: out of memory\n");
+		return -1;
+	}
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * toggleCache
+ */
+int toggleCache(){
+	if(!cacheEnabled){
+		if(cacheEmpty(&caches[CACHE_I]) != 0 || cacheEmpty(&caches[CACHE_D]) != 0) return 0;
+		cacheSeed = 1;
+	}
+	cacheEnabled = !cacheEnabled;
+	return cacheEnabled;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * cacheSet
+ */
+int cacheSet(int cache, CacheConfig config){
+	if(cache != CACHE_I && cache != CACHE_D) return -1;
+	if(config.size <= 0 || config.assoc <= 0 || config.line <= 0) return -1;
+	if(config.size % (config.assoc * config.line) != 0) return -1;
+	if(config.policy < CACHE_LRU || config.policy > CACHE_RANDOM) return -1;
+	caches[cache].config = config;
+	if(cacheEnabled) return cacheEmpty(&caches[cache]);
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * cachePolicy
+ */
+int cachePolicy(char *name){
+	for(int p = CACHE_LRU; p <= CACHE_RANDOM; p++){
+		if(strcmp(name, policyNames[p]) == 0) return p;
+	}
+	return -1;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * cacheChargeMemory
+ *    charge pid one main memory access to the tier holding pAddr
+ *    return: the cycles charged
+ */
+static long cacheChargeMemory(int pid, WORD pAddr){
+	if(pAddr / getPageSize() >= tierSlowFrom){
+		costChargeSlowAccess(pid);
+		return costModel.slowAccess;
+	}
+	costChargeAccess(pid);
+	return costModel.memAccess;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * cacheAccess
+ *    the victim is an invalid line if the set has one; otherwise the
+ *    line with the oldest stamp (LRU, FIFO) or a pseudo-random line
+ *    (a fixed sequence, so that replays see the same misses)
+ */
+void cacheAccess(int cache, int pid, WORD pAddr, int write){
+	Cache *c = &caches[cache];
+	CacheRec *r = cacheGetRec(pid);
+	WORD block = pAddr / c->config.line;
+	int set = block % c->sets;
+	WORD tag = block / c->sets;
+	CacheLine *way = &c->lines[set * c->config.assoc];
+	int victim = -1;
+
+	cacheTime++;
+	r->accesses[cache]++;
+	costChargeCacheHit(pid);
+
+	for(int i = 0; i < c->config.assoc; i++){
+		if(way[i].valid && way[i].tag == tag){
+			if(c->config.policy == CACHE_LRU) way[i].stamp = cacheTime;
+			if(write) way[i].dirty = TRUE;
+			return;
+		}
+		if(!way[i].valid && victim == -1) victim = i;
+	}
+
+	r->misses[cache]++;
+	if(victim == -1){
+		if(c->config.policy == CACHE_RANDOM){
+			cacheSeed = cacheSeed * 6364136223846793005ul + 1442695040888963407ul;
+			victim = (cacheSeed >> 33) % c->config.assoc;
+		}else{
+			victim = 0;
+			for(int i = 1; i < c->config.assoc; i++){
+				if(way[i].stamp < way[victim].stamp) victim = i;
+			}
+		}
+		if(way[victim].dirty){
+			WORD old = (way[victim].tag * c->sets + set) * c->config.line;
+			r->missCycles += cacheChargeMemory(pid, old);
+			r->writeBacks++;
+		}
+	}
+	r->missCycles += cacheChargeMemory(pid, pAddr);
+	way[victim].tag = tag;
+	way[victim].stamp = cacheTime;
+	way[victim].valid = TRUE;
+	way[victim].dirty = write ? TRUE : FALSE;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * cacheInvalidateFrame
+ *    dirty lines are dropped too: the page they belong to has already
+ *    been written back or moved as a whole
+ */
+void cacheInvalidateFrame(int mPageFrame){
+	if(!cacheEnabled) return;
+	for(int cache = CACHE_I; cache <= CACHE_D; cache++){
+		Cache *c = &caches[cache];
+		WORD first = (WORD)mPageFrame * getPageSize() / c->config.line;
+		WORD last = ((WORD)(mPageFrame + 1) * getPageSize() - 1) / c->config.line;
+		for(WORD block = first; block <= last; block++){
+			CacheLine *way = &c->lines[(block % c->sets) * c->config.assoc];
+			for(int i = 0; i < c->config.assoc; i++){
+				if(way[i].valid && way[i].tag == block / c->sets){
+					way[i].valid = FALSE;
+					way[i].dirty = FALSE;
+				}
+			}
+		}
+	}
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * cacheReport
+ */
+void cacheReport(){
+	long accesses[2] = {0, 0};
+	long misses[2] = {0, 0};
+
+	printf("=========================Caches=========================\n");
+	for(int cache = CACHE_I; cache <= CACHE_D; cache++){
+		CacheConfig *cfg = &caches[cache].config;
+		printf("%s: %d words, %d-way, %d-word lines, %s\n", cacheNames[cache],
+		       cfg->size, cfg->assoc, cfg->line, policyNames[cfg->policy]);
+	}
+	printf("hit %ld cycles, miss + one memory access per line filled or written back\n", costModel.cacheHit);
+	printf("PID\tIAcc\tIMiss\tIHit%%\tDAcc\tDMiss\tDHit%%\tWBacks\tMissCyc\n");
+	for(int i = 0; i < nCacheRecs; i++){
+		CacheRec *r = &cacheRecs[i];
+		printf("%d\t%ld\t%ld\t%.1f\t%ld\t%ld\t%.1f\t%ld\t%ld\n", r->pid,
+		       r->accesses[CACHE_I], r->misses[CACHE_I],
+		       r->accesses[CACHE_I] ? 100.0 - 100.0 * r->misses[CACHE_I] / r->accesses[CACHE_I] : 0.0,
+		       r->accesses[CACHE_D], r->misses[CACHE_D],
+		       r->accesses[CACHE_D] ? 100.0 - 100.0 * r->misses[CACHE_D] / r->accesses[CACHE_D] : 0.0,
+		       r->writeBacks, r->missCycles);
+		for(int cache = CACHE_I; cache <= CACHE_D; cache++){
+			accesses[cache] += r->accesses[cache];
+			misses[cache] += r->misses[cache];
+		}
+	}
+	if(nCacheRecs == 0){
+		printf("   (NO CACHE ACCESSES)\n");
+	}
+	for(int cache = CACHE_I; cache <= CACHE_D; cache++){
+		printf("%s total: %ld accesses, %ld misses, hit rate %.1f%%\n", cacheNames[cache],
+		       accesses[cache], misses[cache],
+		       accesses[cache] ? 100.0 - 100.0 * misses[cache] / accesses[cache] : 0.0);
+	}
+	printf("========================================================\n");
+}
+/*================================================================================*/
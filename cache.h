@@ -0,0 +1,94 @@
+/*
+ * cache.h
+ * set-associative instruction and data cache model for fos os
+ * Joshua Castelli/Nathan Helmig
+ *
+ * the caches sit between the cpu and mainMem, after translation, so they
+ * are indexed and tagged by physical address and are shared by every
+ * process. a read at vAddr == cpu.pc (an instruction fetch or the address
+ * word after one, as in prof.h) goes to the I-cache; every other cpu
+ * read or write goes to the D-cache. block moves, dumps and the other
+ * accesses the OS makes for a process bypass the caches
+ *
+ * the model only keeps time, the words themselves stay in mainMem.
+ * every access costs costModel.cacheHit cycles; a miss also pays one
+ * main memory access at the latency of the line's tier (cost.h, tier.h)
+ * to fill the line, and one more to write back a dirty D-cache line it
+ * replaces (write-back, write-allocate). when a main page frame gets a
+ * new page its lines are dropped
+ *
+ * while the model is off every access costs one main memory access,
+ * as before
+ */
+
+#ifndef CACHE_H
+#define CACHE_H
+
+#include "computer2.h"
+
+#define CACHE_I 0
+#define CACHE_D 1
+
+#define CACHE_LRU 0
+#define CACHE_FIFO 1
+#define CACHE_RANDOM 2
+
+/*
+ * CacheConfig - shape of one cache
+ *    size      words
+ *    assoc     lines per set
+ *    line      words per line
+ *    policy    CACHE_LRU, CACHE_FIFO or CACHE_RANDOM
+ */
+typedef struct {
+	int size;
+	int assoc;
+	int line;
+	int policy;
+} CacheConfig;
+
+extern int cacheEnabled;
+
+/*
+ * toggleCache
+ *    turn the cache model on (or off); the caches start empty
+ *    return: 1 if the caches are on, 0 if off
+ */
+int toggleCache();
+
+/*
+ * cacheSet
+ *    reshape cache (CACHE_I or CACHE_D); it is emptied
+ *
+ *    return
+ *       0 success
+ *       -1 bad shape (size must be a multiple of assoc * line)
+ */
+int cacheSet(int cache, CacheConfig config);
+
+/*
+ * cachePolicy
+ *    return: the policy named (lru, fifo, random), -1 if unknown
+ */
+int cachePolicy(char *name);
+
+/*
+ * cacheAccess
+ *    look pAddr up in cache for pid, charging the cost model
+ */
+void cacheAccess(int cache, int pid, WORD pAddr, int write);
+
+/*
+ * cacheInvalidateFrame
+ *    drop every line of main page frame mPageFrame
+ */
+void cacheInvalidateFrame(int mPageFrame);
+
+/*
+ * cacheReport
+ *    print the shape of both caches and, per process, accesses, misses,
+ *    hit rates, write-backs and the cycles charged for misses
+ */
+void cacheReport();
+
+#endif
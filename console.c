@@ -0,0 +1,405 @@
+/*
+ * console.c
+ * buffered guest console output for fos os
+ * Joshua Castelli/Nathan Helmig
+ */
+
+#define _GNU_SOURCE
+#include "console.h"
+#include "replay.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+/*
+ * ConsoleRec - what one process has printed and not yet handed over
+ *    file    its pid<PID>.out (CONSOLE_FILES), opened on first flush
+ */
+typedef struct {
+	int pid;
+	int n;
+	FILE *file;
+	char buf[CONSOLE_BUFFER];
+} ConsoleRec;
+
+/*
+ * ConsoleChunk - a buffer handed to the writer
+ *    close   fclose out once written (the process ended)
+ */
+typedef struct ConsoleChunk {
+	FILE *out;
+	int len;
+	int close;
+	struct ConsoleChunk *next;
+	char data[];
+} ConsoleChunk;
+
+int consoleMode = CONSOLE_OFF;
+
+static char *modeNames[3] = {"off", "stdout", "files"};
+
+static ConsoleRec **recs = NULL;
+static int nRecs = 0;
+static int capRecs = 0;
+
+/* pid -> index in recs, open addressing like the process table's */
+static int *hashPid = NULL;
+static int *hashRec = NULL;
+static int hashCap = 0;
+
+static FILE *guestOut = NULL;       // the stream stdout is swapped for
+static FILE *hostOut = NULL;        // stdout while a process is attached
+static ConsoleRec *attached = NULL;
+
+static pthread_mutex_t conLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t conQueued = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t conWritten = PTHREAD_COND_INITIALIZER;
+static ConsoleChunk *conHead = NULL;
+static ConsoleChunk *conTail = NULL;
+static int conRunning = 0;
+static pthread_t conThread;
+
+static long guestBytes = 0;
+static long hostWrites = 0;
+
+/*================================================================================*/
+/*
+ * consoleWriteChunk
+ *    write one chunk (the caller frees it)
+ */
+static void consoleWriteChunk(ConsoleChunk *chunk){
+	if(chunk->len > 0){
+		fwrite(chunk->data, 1, chunk->len, chunk->out);
+		fflush(chunk->out);
+	}
+	if(chunk->close) fclose(chunk->out);
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * consoleWriter
+ *    write chunks in order, forever
+ */
+static void* consoleWriter(void *arg){
+	(void)arg;
+	pthread_mutex_lock(&conLock);
+	for(;;){
+		while(conHead == NULL){
+			pthread_cond_wait(&conQueued, &conLock);
+		}
+		ConsoleChunk *chunk = conHead;
+		pthread_mutex_unlock(&conLock);
+
+		consoleWriteChunk(chunk);
+
+		/* the chunk leaves the queue only once it is written, for consoleSync */
+		pthread_mutex_lock(&conLock);
+		conHead = chunk->next;
+		if(conHead == NULL) conTail = NULL;
+		free(chunk);
+		pthread_cond_broadcast(&conWritten);
+	}
+	return NULL;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * consoleHandOver
+ *    queue len bytes of rec for its sink; close its file afterwards if
+ *    close is set
+ */
+static void consoleHandOver(ConsoleRec *rec, int close){
+	FILE *out = hostOut != NULL ? hostOut : stdout;
+
+	if(rec->n == 0 && !(close && rec->file != NULL)) return;
+	if(consoleMode == CONSOLE_FILES && rec->file == NULL){
+		char name[32];
+		snprintf(name, sizeof(name), "pid%d.out", rec->pid);
+		rec->file = fopen(name, "w");
+		if(rec->file == NULL) fprintf(stderr, "CONSOLE: cannot create %s, writing to stdout\n", name);
+	}
+	if(rec->file != NULL) out = rec->file;
+
+	ConsoleChunk *chunk = malloc(sizeof(ConsoleChunk) + rec->n);
+	if(chunk == NULL){
+		fprintf(stderr, "CONSOLE: out of memory\n");
+		exit(1);
+	}
+	chunk->out = out;
+	chunk->len = rec->n;
+	chunk->close = close && rec->file != NULL;
+	chunk->next = NULL;
+	memcpy(chunk->data, rec->buf, rec->n);
+	if(chunk->close) rec->file = NULL;
+	rec->n = 0;
+	if(chunk->len > 0) hostWrites++;
+
+	if(replayMode != REPLAY_OFF || !conRunning){
+		consoleWriteChunk(chunk);
+		free(chunk);
+		return;
+	}
+	pthread_mutex_lock(&conLock);
+	if(conTail == NULL) conHead = chunk;
+	else conTail->next = chunk;
+	conTail = chunk;
+	pthread_cond_signal(&conQueued);
+	pthread_mutex_unlock(&conLock);
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * consoleGuestWrite - the attached process's stdout
+ */
+static ssize_t consoleGuestWrite(void *cookie, const char *buf, size_t size){
+	ConsoleRec *rec = attached;
+
+	(void)cookie;
+	guestBytes += size;
+	for(size_t done = 0; done < size; ){
+		size_t n = size - done;
+		if(n > (size_t)(CONSOLE_BUFFER - rec->n)) n = CONSOLE_BUFFER - rec->n;
+		memcpy(rec->buf + rec->n, buf + done, n);
+		rec->n += n;
+		done += n;
+		if(rec->n == CONSOLE_BUFFER) consoleHandOver(rec, 0);
+	}
+	return size;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * consoleHashFind
+ *    return the hash index holding pid, or the empty index where it would go
+ */
+static int consoleHashFind(int pid){
+	int i = (unsigned)pid * 2654435761u & (hashCap - 1);
+	while(hashPid[i] != 0 && hashPid[i] != pid){
+		i = (i + 1) & (hashCap - 1);
+	}
+	return i;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * consoleHashGrow
+ *    double the hash and rehash every pid
+ */
+static void consoleHashGrow(){
+	int *oldPid = hashPid;
+	int *oldRec = hashRec;
+	int oldCap = hashCap;
+
+	hashCap = oldCap ? oldCap * 2 : 32;
+	hashPid = calloc(hashCap, sizeof(int));
+	hashRec = calloc(hashCap, sizeof(int));
+	if(hashPid == NULL || hashRec == NULL){
+		fprintf(stderr, "CONSOLE: out of memory\n");
+		exit(1);
+	}
+	for(int i = 0; i < oldCap; i++){
+		if(oldPid[i] != 0){
+			int j = consoleHashFind(oldPid[i]);
+			hashPid[j] = oldPid[i];
+			hashRec[j] = oldRec[i];
+		}
+	}
+	free(oldPid);
+	free(oldRec);
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * consoleHashRemove
+ *    remove pid, shifting later entries of its probe run back
+ */
+static void consoleHashRemove(int pid){
+	int i = consoleHashFind(pid);
+	if(hashPid[i] == 0) return;
+	hashPid[i] = 0;
+	for(int j = (i + 1) & (hashCap - 1); hashPid[j] != 0; j = (j + 1) & (hashCap - 1)){
+		int home = (unsigned)hashPid[j] * 2654435761u & (hashCap - 1);
+		/* move j into the hole at i unless its home lies in (i, j] */
+		if((j > i && (home <= i || home > j)) || (j < i && home <= i && home > j)){
+			hashPid[i] = hashPid[j];
+			hashRec[i] = hashRec[j];
+			hashPid[j] = 0;
+			i = j;
+		}
+	}
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * consoleFind
+ *    index of the record of pid, -1 if it has none
+ */
+static int consoleFind(int pid){
+	if(hashCap == 0) return -1;
+	int h = consoleHashFind(pid);
+	return hashPid[h] == pid ? hashRec[h] : -1;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * consoleAtExit
+ *    nothing printed is lost when the OS exits
+ */
+static void consoleAtExit(){
+	consoleDetach();
+	consoleFlush(-1);
+	consoleSync();
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * consoleSetMode
+ */
+int consoleSetMode(char *name){
+	int mode = -1;
+
+	for(int m = CONSOLE_OFF; m <= CONSOLE_FILES; m++){
+		if(strcmp(name, modeNames[m]) == 0) mode = m;
+	}
+	if(mode == -1) return -1;
+
+	if(mode != CONSOLE_OFF && guestOut == NULL){
+		cookie_io_functions_t io = {NULL, consoleGuestWrite, NULL, NULL};
+		guestOut = fopencookie(NULL, "w", io);
+		if(guestOut == NULL) return -1;
+		setvbuf(guestOut, NULL, _IONBF, 0);
+		atexit(consoleAtExit);
+	}
+	if(mode != CONSOLE_OFF && !conRunning){
+		if(pthread_create(&conThread, NULL, consoleWriter, NULL) != 0) return -1;
+		pthread_detach(conThread);
+		conRunning = 1;
+	}
+
+	/* buffers and files of the old mode are finished with */
+	for(int i = 0; i < nRecs; i++){
+		consoleHandOver(recs[i], 1);
+	}
+	consoleSync();
+	consoleMode = mode;
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * consoleAttach
+ */
+void consoleAttach(int pid){
+	if(consoleMode == CONSOLE_OFF) return;
+
+	int i = consoleFind(pid);
+	if(i == -1){
+		if(nRecs == capRecs){
+			capRecs = capRecs ? capRecs * 2 : 16;
+			recs = realloc(recs, capRecs * sizeof(ConsoleRec*));
+			if(recs == NULL){
+				fprintf(stderr, "CONSOLE: out of memory\n");
+				exit(1);
+			}
+		}
+		recs[nRecs] = malloc(sizeof(ConsoleRec));
+		if(recs[nRecs] == NULL){
+			fprintf(stderr, "CONSOLE: out of memory\n");
+			exit(1);
+		}
+		recs[nRecs]->pid = pid;
+		recs[nRecs]->n = 0;
+		recs[nRecs]->file = NULL;
+		if(2 * (nRecs + 1) > hashCap) consoleHashGrow();
+		int h = consoleHashFind(pid);
+		hashPid[h] = pid;
+		hashRec[h] = nRecs;
+		i = nRecs++;
+	}
+
+	/* what the OS printed before the quantum comes out first */
+	fflush(stdout);
+	attached = recs[i];
+	hostOut = stdout;
+	stdout = guestOut;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * consoleDetach
+ */
+void consoleDetach(){
+	if(attached == NULL) return;
+	stdout = hostOut;
+	hostOut = NULL;
+	attached = NULL;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * consoleFlush
+ */
+void consoleFlush(int pid){
+	if(pid != -1){
+		int i = consoleFind(pid);
+		if(i != -1) consoleHandOver(recs[i], 0);
+		return;
+	}
+	for(int i = 0; i < nRecs; i++){
+		consoleHandOver(recs[i], 0);
+	}
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * consoleClose
+ */
+void consoleClose(int pid){
+	int i = consoleFind(pid);
+	if(i == -1) return;
+	if(attached == recs[i]) consoleDetach();
+	consoleHandOver(recs[i], 1);
+	free(recs[i]);
+	consoleHashRemove(pid);
+	recs[i] = recs[--nRecs];
+	if(i < nRecs) hashRec[consoleHashFind(recs[i]->pid)] = i;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * consoleSync
+ */
+void consoleSync(){
+	if(!conRunning) return;
+	pthread_mutex_lock(&conLock);
+	while(conHead != NULL){
+		pthread_cond_wait(&conWritten, &conLock);
+	}
+	pthread_mutex_unlock(&conLock);
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * consoleReport
+ */
+void consoleReport(){
+	printf("console output %s: %ld bytes printed by processes in %ld host writes\n",
+	       modeNames[consoleMode], guestBytes, hostWrites);
+}
+/*================================================================================*/
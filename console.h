@@ -0,0 +1,86 @@
+/*
+ * console.h
+ * buffered guest console output for fos os
+ * Joshua Castelli/Nathan Helmig
+ *
+ * the cpu prints DISC and DISM output to stdout as each instruction
+ * runs. with buffering on, stdout is swapped for a stream into the
+ * running process's own buffer for the length of each quantum, so a
+ * guest that prints in a loop only copies bytes. a buffer is handed to
+ * a writer thread when it fills, when its process ends and on an
+ * explicit flush; the writer sends it on to stdout, or to the file
+ * pid<PID>.out. the writer keeps the order buffers are handed over, so
+ * the output of each process comes out in the order it was printed;
+ * the output of different processes comes out a buffer at a time
+ *
+ * everything printed while a process runs goes to its buffer, cpu and
+ * vmm noise included. while a session is recorded or replayed the
+ * buffers are written without the thread, so that stdout, which is
+ * hashed at every prompt, gets the same bytes in the same order
+ *
+ * like trace.c this does not include computer2.h (pthread.h pulls in
+ * time.h)
+ */
+
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#define CONSOLE_BUFFER 4096     // bytes buffered per process
+
+#define CONSOLE_OFF 0           // the cpu prints straight to stdout
+#define CONSOLE_STDOUT 1        // buffered, written to stdout
+#define CONSOLE_FILES 2         // buffered, written to pid<PID>.out
+
+extern int consoleMode;
+
+/*
+ * consoleSetMode
+ *    switch to the mode named (off, stdout, files); output buffered so
+ *    far is flushed under the old mode first
+ *
+ *    return
+ *       0 success
+ *       -1 unknown name, or the writer could not be started
+ */
+int consoleSetMode(char *name);
+
+/*
+ * consoleAttach
+ *    send stdout to the buffer of pid until consoleDetach
+ *    (nothing is done while buffering is off)
+ */
+void consoleAttach(int pid);
+
+/*
+ * consoleDetach
+ *    give stdout back
+ */
+void consoleDetach();
+
+/*
+ * consoleFlush
+ *    hand what pid has buffered to the writer (pid -1: every process)
+ */
+void consoleFlush(int pid);
+
+/*
+ * consoleClose
+ *    flush pid and forget it (the process has ended); its file, if
+ *    any, is closed once written
+ */
+void consoleClose(int pid);
+
+/*
+ * consoleSync
+ *    wait until the writer has written everything handed to it
+ */
+void consoleSync();
+
+/*
+ * consoleReport
+ *    print the mode, the bytes the guests printed and the host writes
+ *    they took
+ */
+void consoleReport();
+
+#endif
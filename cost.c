@@ -0,0 +1,291 @@
+/*
+ * cost.c
+ * memory-hierarchy latency model and simulated cycle accounting for fos os
+ * Joshua Castelli/Nathan Helmig
+ */
+
+#include "cost.h"
+#include "proctab.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * CostRec - what one process has been charged
+ *    stall counts the cycles of faults, secondary reads and write-backs
+ *    prefetches counts the pages read in ahead of use (vmmAdvise)
+ *    switches counts the times its registers were restored
+ *    wait counts the cycles blocked on asynchronous faults (another
+ *    process may have run meanwhile, so they are not in cycles)
+ *    fastCycles and slowCycles split the memory access cycles by tier
+ */
+typedef struct {
+	int pid;
+	long cycles;
+	long inst;
+	long accesses;
+	long faults;
+	long prefetches;
+	long writeBacks;
+	long switches;
+	long stall;
+	long wait;
+	long fastCycles;
+	long slowCycles;
+} CostRec;
+
+CostModel costModel = {
+	1,      // inst
+	2,      // memAccess
+	8,      // slowAccess
+	100,    // pageFault
+	50,     // secRead
+	50,     // writeBack
+	1,      // migrate
+	1,      // cacheHit
+	20      // ctxSwitch
+};
+
+long simCycles = 0;
+long idleCycles = 0;
+long fastTierCycles = 0;
+long slowTierCycles = 0;
+
+static CostRec *costRecs = NULL;
+static int nCostRecs = 0;
+static int capCostRecs = 0;
+static int lastCostRec = -1;
+
+/*================================================================================*/
+/*
+ * costFindRec
+ *    index of the cost record of pid, -1 if it has none. a process in
+ *    the process table keeps the index (costRec); only the records of
+ *    processes that have ended are searched for
+ */
+static int costFindRec(int pid, ProcEntry *entry){
+	if(entry != NULL && entry->costRec != -1) return entry->costRec;
+	for(int i = 0; i < nCostRecs; i++){
+		if(costRecs[i].pid == pid){
+			if(entry != NULL) entry->costRec = i;
+			return i;
+		}
+	}
+	return -1;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * costGetRec
+ *    the cost record of pid, created on first use
+ */
+static CostRec* costGetRec(int pid){
+	if(lastCostRec != -1 && costRecs[lastCostRec].pid == pid) return &costRecs[lastCostRec];
+	ProcEntry *entry = (ProcEntry*)procTableFind(pid);
+	int i = costFindRec(pid, entry);
+	if(i != -1){
+		lastCostRec = i;
+		return &costRecs[i];
+	}
+	if(nCostRecs == capCostRecs){
+		capCostRecs = capCostRecs ? capCostRecs * 2 : 16;
+		costRecs = realloc(costRecs, capCostRecs * sizeof(CostRec));
+		if(costRecs == NULL){
+			fprintf(stderr, "COST: out of memory\n");
+			exit(1);
+		}
+	}
+	memset(&costRecs[nCostRecs], 0, sizeof(CostRec));
+	costRecs[nCostRecs].pid = pid;
+	if(entry != NULL) entry->costRec = nCostRecs;
+	lastCostRec = nCostRecs;
+	return &costRecs[nCostRecs++];
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * costSet
+ *    return 0 success, -1 unknown name or negative value
+ */
+int costSet(char *name, long value){
+	if(value < 0) return -1;
+	if(strcmp(name, "inst") == 0){
+		costModel.inst = value;
+	}else if(strcmp(name, "mem") == 0){
+		costModel.memAccess = value;
+	}else if(strcmp(name, "slowmem") == 0){
+		costModel.slowAccess = value;
+	}else if(strcmp(name, "fault") == 0){
+		costModel.pageFault = value;
+	}else if(strcmp(name, "secread") == 0){
+		costModel.secRead = value;
+	}else if(strcmp(name, "writeback") == 0){
+		costModel.writeBack = value;
+	}else if(strcmp(name, "migrate") == 0){
+		costModel.migrate = value;
+	}else if(strcmp(name, "cachehit") == 0){
+		costModel.cacheHit = value;
+	}else if(strcmp(name, "switch") == 0){
+		costModel.ctxSwitch = value;
+	}else{
+		return -1;
+	}
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * charges
+ */
+void costChargeInst(int pid, long count){
+	CostRec *r = costGetRec(pid);
+	long c = count * costModel.inst;
+	r->inst += count;
+	r->cycles += c;
+	simCycles += c;
+}
+
+void costChargeAccess(int pid){
+	CostRec *r = costGetRec(pid);
+	r->accesses++;
+	r->cycles += costModel.memAccess;
+	r->fastCycles += costModel.memAccess;
+	fastTierCycles += costModel.memAccess;
+	simCycles += costModel.memAccess;
+}
+
+void costChargeAccesses(int pid, long count){
+	CostRec *r = costGetRec(pid);
+	r->accesses += count;
+	r->cycles += count * costModel.memAccess;
+	r->fastCycles += count * costModel.memAccess;
+	fastTierCycles += count * costModel.memAccess;
+	simCycles += count * costModel.memAccess;
+}
+
+void costChargeSlowAccess(int pid){
+	CostRec *r = costGetRec(pid);
+	r->accesses++;
+	r->cycles += costModel.slowAccess;
+	r->slowCycles += costModel.slowAccess;
+	slowTierCycles += costModel.slowAccess;
+	simCycles += costModel.slowAccess;
+}
+
+void costChargeSlowAccesses(int pid, long count){
+	CostRec *r = costGetRec(pid);
+	r->accesses += count;
+	r->cycles += count * costModel.slowAccess;
+	r->slowCycles += count * costModel.slowAccess;
+	slowTierCycles += count * costModel.slowAccess;
+	simCycles += count * costModel.slowAccess;
+}
+
+void costChargeFault(int pid, int words){
+	CostRec *r = costGetRec(pid);
+	long c = costModel.pageFault + words * costModel.secRead;
+	r->faults++;
+	r->stall += c;
+	r->cycles += c;
+	simCycles += c;
+}
+
+void costChargePrefetch(int pid, int words){
+	CostRec *r = costGetRec(pid);
+	long c = words * costModel.secRead;
+	r->prefetches++;
+	r->stall += c;
+	r->cycles += c;
+	simCycles += c;
+}
+
+void costChargeWriteBack(int pid, int words){
+	CostRec *r = costGetRec(pid);
+	long c = words * costModel.writeBack;
+	r->writeBacks++;
+	r->stall += c;
+	r->cycles += c;
+	simCycles += c;
+}
+
+void costChargeSwitch(int pid){
+	CostRec *r = costGetRec(pid);
+	r->switches++;
+	r->cycles += costModel.ctxSwitch;
+	simCycles += costModel.ctxSwitch;
+}
+
+void costChargeCacheHit(int pid){
+	CostRec *r = costGetRec(pid);
+	r->cycles += costModel.cacheHit;
+	simCycles += costModel.cacheHit;
+}
+
+long costFaultCycles(int words, int writeBack){
+	return costModel.pageFault + words * costModel.secRead + (writeBack ? words * costModel.writeBack : 0);
+}
+
+void costChargeWait(int pid, long cycles, int writeBack){
+	CostRec *r = costGetRec(pid);
+	r->faults++;
+	if(writeBack) r->writeBacks++;
+	r->wait += cycles;
+}
+
+void costChargeIdle(long cycles){
+	idleCycles += cycles;
+	simCycles += cycles;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * costProcess
+ */
+int costProcess(int pid, long *cycles, long *inst, long *faults, long *writeBacks){
+	int i = costFindRec(pid, (ProcEntry*)procTableFind(pid));
+	if(i == -1) return -1;
+	*cycles = costRecs[i].cycles;
+	*inst = costRecs[i].inst;
+	*faults = costRecs[i].faults;
+	*writeBacks = costRecs[i].writeBacks;
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * costFaults
+ */
+long costFaults(int pid){
+	return costGetRec(pid)->faults;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * costReport
+ */
+void costReport(){
+	printf("=========================Cost Model=========================\n");
+	printf("inst %ld\tmem %ld\tslowmem %ld\tfault %ld\tsecread %ld/word\twriteback %ld/word\tmigrate %ld/word\tcachehit %ld\tswitch %ld\n",
+	       costModel.inst, costModel.memAccess, costModel.slowAccess, costModel.pageFault,
+	       costModel.secRead, costModel.writeBack, costModel.migrate, costModel.cacheHit, costModel.ctxSwitch);
+	printf("PID\tCycles\tInst\tCPI\tFaults\tPref\tWBacks\tStall\tStall%%\tWait\tFast\tSlow\tSwitch\n");
+	for(int i = 0; i < nCostRecs; i++){
+		CostRec *r = &costRecs[i];
+		printf("%d\t%ld\t%ld\t%.2f\t%ld\t%ld\t%ld\t%ld\t%.1f\t%ld\t%ld\t%ld\t%ld\n", r->pid, r->cycles, r->inst,
+		       r->inst ? (double)r->cycles / r->inst : 0.0, r->faults, r->prefetches, r->writeBacks,
+		       r->stall, r->cycles ? 100.0 * r->stall / r->cycles : 0.0, r->wait,
+		       r->fastCycles, r->slowCycles, r->switches);
+	}
+	if(nCostRecs == 0){
+		printf("   (NO PROCESSES RUN)\n");
+	}
+	printf("total simulated cycles: %ld (idle %ld)\n", simCycles, idleCycles);
+	printf("============================================================\n");
+}
+/*================================================================================*/
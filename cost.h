@@ -0,0 +1,122 @@
+/*
+ * cost.h
+ * memory-hierarchy latency model and simulated cycle accounting for fos os
+ * Joshua Castelli/Nathan Helmig
+ */
+
+#ifndef COST_H
+#define COST_H
+
+#include "computer2.h"
+
+/*
+ * CostModel - latencies, in simulated cycles
+ *    inst          cycles to execute one instruction
+ *    memAccess     cycles for one main memory access after translation
+ *    slowAccess    the same, for a page in the slow tier of main memory
+ *    pageFault     fixed cycles to take a page fault (trap + handler)
+ *    secRead       cycles per word copied from secondary to main memory
+ *    writeBack     cycles per word of a dirty page written back to secondary
+ *    migrate       cycles per word the tier migration engine copies
+ *    cacheHit      cycles for one access that hits in a cache (cache.h)
+ *    ctxSwitch     cycles to save one process's registers and restore
+ *                  another's (scheduler.h)
+ *
+ * every charge is made against the process that caused it; a process
+ * faulting on a dirty victim page pays for the write-back too. a page
+ * read in ahead of use (vmmAdvise) costs its secondary reads but no
+ * fault
+ */
+typedef struct {
+	long inst;
+	long memAccess;
+	long slowAccess;
+	long pageFault;
+	long secRead;
+	long writeBack;
+	long migrate;
+	long cacheHit;
+	long ctxSwitch;
+} CostModel;
+
+extern CostModel costModel;
+
+/*
+ * simulated cycles since start-up, over all processes
+ */
+extern long simCycles;
+
+/*
+ * simulated cycles in which every process was waiting on a page fault
+ */
+extern long idleCycles;
+
+/*
+ * memory access cycles spent in the fast and the slow tier (see tier.h)
+ */
+extern long fastTierCycles;
+extern long slowTierCycles;
+
+/*
+ * costSet
+ *    change one latency of the cost model by name
+ *    (inst, mem, slowmem, fault, secread, writeback, migrate, cachehit,
+ *    switch)
+ *
+ *    return
+ *       0 success
+ *       -1 unknown name or negative value
+ */
+int costSet(char *name, long value);
+
+/*
+ * charges made by the cpu and vmm paths
+ */
+void costChargeInst(int pid, long count);
+void costChargeAccess(int pid);
+void costChargeAccesses(int pid, long count);
+void costChargeSlowAccess(int pid);
+void costChargeSlowAccesses(int pid, long count);
+void costChargeCacheHit(int pid);
+void costChargeFault(int pid, int words);
+void costChargePrefetch(int pid, int words);
+void costChargeWriteBack(int pid, int words);
+void costChargeSwitch(int pid);
+
+/*
+ * charges made by the scheduler for asynchronous page faults
+ *    costFaultCycles - how long the I/O of one fault takes
+ *    costChargeWait  - pid waited cycles for a fault (not cpu time, so
+ *                      it is not added to simCycles)
+ *    costChargeIdle  - no process could run for cycles
+ */
+long costFaultCycles(int words, int writeBack);
+void costChargeWait(int pid, long cycles, int writeBack);
+void costChargeIdle(long cycles);
+
+/*
+ * costProcess
+ *    what pid has been charged so far
+ *
+ *    return
+ *       0 success
+ *       -1 nothing has been charged to pid
+ */
+int costProcess(int pid, long *cycles, long *inst, long *faults, long *writeBacks);
+
+/*
+ * costFaults
+ *    the page faults charged to pid so far (cheap for the process
+ *    charged last, the scheduler asks after every quantum)
+ */
+long costFaults(int pid);
+
+/*
+ * costReport
+ *    print the cost model and, per process, simulated cycles, CPI and
+ *    the cycles spent stalled on page faults and write-backs, waiting
+ *    on asynchronous faults and accessing each memory tier
+ */
+void costReport();
+
+#endif
@@ -0,0 +1,359 @@
+/*
+ * fex.c
+ * .fex2 program file parser for fos os
+ * Joshua Castelli/Nathan Helmig
+ */
+
+#include "fex.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <stdatomic.h>
+#include <pthread.h>
+
+/*
+ * FexOp - what fexVerify checks of one opcode
+ *    regs      operand characters (after the opcode) that are registers
+ *    target    what the address word that follows must hold, if any
+ *
+ * the letters are those of frisc2.h, which is not included here (it
+ * defines clock)
+ */
+#define FEX_NO_ADDR 0
+#define FEX_IMMEDIATE 1
+#define FEX_BRANCH 2
+#define FEX_LOAD 3
+#define FEX_STORE 4
+
+typedef struct {
+	char op;
+	int regs;
+	int target;
+} FexOp;
+
+static const FexOp fexOps[] = {
+	{'m', 1, FEX_LOAD},         // LODM
+	{'l', 1, FEX_IMMEDIATE},    // LOIM
+	{'s', 1, FEX_STORE},        // STDM
+	{'t', 1, FEX_LOAD},         // STIM
+	{'i', 1, FEX_NO_ADDR},      // INCR
+	{'r', 1, FEX_NO_ADDR},      // DECR
+	{'a', 3, FEX_NO_ADDR},      // ADDR
+	{'u', 3, FEX_NO_ADDR},      // SUBR
+	{'c', 2, FEX_NO_ADDR},      // COMP
+	{'b', 0, FEX_BRANCH},       // BRAN
+	{'n', 0, FEX_BRANCH},       // BRNN
+	{'z', 1, FEX_NO_ADDR},      // CLER
+	{'d', 1, FEX_NO_ADDR},      // DISC
+	{'o', 0, FEX_LOAD},         // DISM
+	{'e', 0, FEX_NO_ADDR},      // EXIT
+	{'x', 0, FEX_NO_ADDR},      // NOP
+	{'T', 0, FEX_NO_ADDR},      // TX2N
+	{'N', 0, FEX_NO_ADDR},      // N2TX
+	{'P', 1, FEX_NO_ADDR},      // PUSH
+	{'O', 1, FEX_NO_ADDR},      // POP
+	{'S', 0, FEX_BRANCH},       // GOSU
+	{'R', 0, FEX_NO_ADDR},      // RETU
+	{'M', 3, FEX_NO_ADDR},      // BMOV
+	{'F', 3, FEX_NO_ADDR},      // BFIL
+	{'A', 2, FEX_NO_ADDR},      // ADVS
+	{'Y', 2, FEX_NO_ADDR},      // SPWN
+	{'J', 2, FEX_NO_ADDR}       // JOIN
+};
+
+/*
+ * work shared by the fexParseMany threads
+ */
+typedef struct {
+	char **files;
+	FexImage *images;
+	int n;
+	int verify;
+	_Atomic int next;
+	_Atomic int failed;
+} FexWork;
+
+/*================================================================================*/
+/*
+ * fexHeaderLine
+ *    next header number of fin
+ *    return: the number, -1 if there is none
+ */
+static int fexHeaderLine(FILE *fin){
+	char line[256];
+	if(fgets(line, sizeof(line), fin) == NULL || !isdigit((unsigned char)line[0])) return -1;
+	return atoi(line);
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * fexParseFile
+ */
+int fexParseFile(char *fileName, FexImage *image){
+	char line[256];
+	char word[256];
+	int addr;
+
+	memset(image, 0, sizeof(FexImage));
+	image->fileName = fileName;
+
+	FILE *fin = fopen(fileName, "r");
+	if(fin == NULL){
+		snprintf(image->error, sizeof(image->error), "cannot open file");
+		return -1;
+	}
+	if(fgets(line, sizeof(line), fin) == NULL || strncmp(line, "fex2", 4) != 0){
+		snprintf(image->error, sizeof(image->error), "not a fex2 file");
+		fclose(fin);
+		return -1;
+	}
+	image->stackSize = fexHeaderLine(fin);
+	image->heapSize = fexHeaderLine(fin);
+	image->codeSize = fexHeaderLine(fin);
+	if(image->stackSize < 0 || image->heapSize < 0 || image->codeSize < 0){
+		snprintf(image->error, sizeof(image->error), "bad stack/heap/code size");
+		fclose(fin);
+		return -1;
+	}
+	image->size = image->stackSize + image->heapSize + image->codeSize;
+
+	image->kind = malloc(image->size + 1);
+	image->data = calloc(image->size + 1, sizeof(long));
+	image->inst = calloc(image->size + 1, sizeof(*image->inst));
+	if(image->kind == NULL || image->data == NULL || image->inst == NULL){
+		snprintf(image->error, sizeof(image->error), "out of memory");
+		fclose(fin);
+		fexFree(image);
+		return -1;
+	}
+	memset(image->kind, FEX_EMPTY, image->size + 1);
+
+	for(int lineNo = 5; fgets(line, sizeof(line), fin) != NULL; lineNo++){
+		if(line[0] == '#' || sscanf(line, "%d %255s", &addr, word) != 2) continue;
+		if(addr < 0 || addr >= image->size){
+			snprintf(image->error, sizeof(image->error), "line %d: address %d outside program", lineNo, addr);
+			fclose(fin);
+			fexFree(image);
+			return -1;
+		}
+		if(isdigit((unsigned char)word[0]) || word[0] == '-'){
+			image->kind[addr] = FEX_DATA;
+			image->data[addr] = atol(word);
+		}else{
+			size_t len = strlen(word);
+			image->kind[addr] = FEX_INST;
+			memset(image->inst[addr], 0, 4);
+			memcpy(image->inst[addr], word, len < 4 ? len : 4);
+		}
+	}
+	fclose(fin);
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * fexWorker
+ *    parse (and verify) files until none are left
+ */
+static void* fexWorker(void *arg){
+	FexWork *work = arg;
+	int i;
+	while((i = atomic_fetch_add(&work->next, 1)) < work->n){
+		if(fexParseFile(work->files[i], &work->images[i]) != 0
+		   || (work->verify && fexVerify(&work->images[i]) != 0)){
+			atomic_fetch_add(&work->failed, 1);
+		}
+	}
+	return NULL;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * fexParseMany
+ *    the calling thread is one of the workers
+ */
+int fexParseMany(char *files[], int n, FexImage images[], int threads, int verify){
+	FexWork work;
+	work.files = files;
+	work.images = images;
+	work.n = n;
+	work.verify = verify;
+	atomic_init(&work.next, 0);
+	atomic_init(&work.failed, 0);
+
+	if(threads > n) threads = n;
+	if(threads < 1) threads = 1;
+	pthread_t tids[threads];
+	int started = 0;
+	for(int t = 1; t < threads; t++){
+		if(pthread_create(&tids[started], NULL, fexWorker, &work) == 0) started++;
+	}
+	fexWorker(&work);
+	for(int t = 0; t < started; t++){
+		pthread_join(tids[t], NULL);
+	}
+	return atomic_load(&work.failed);
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * fexFindOp
+ *    return: the FexOp of opcode letter op, NULL if there is none
+ */
+static const FexOp* fexFindOp(char op){
+	int nOps = sizeof(fexOps) / sizeof(fexOps[0]);
+
+	for(int i = 0; i < nOps; i++){
+		if(fexOps[i].op == op) return &fexOps[i];
+	}
+	return NULL;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * fexReach
+ *    follow the code from the entry point, as fexVerify has checked it:
+ *    a branch goes to its target, and every instruction but BRAN, EXIT
+ *    and RETU on to the next (a GOSU is returned to there). every word
+ *    reached must be an instruction; where threads start (SPWN) and
+ *    where RETU goes are in registers, and are not followed
+ *    return: 0, -1 if control can reach a data word or run past the
+ *    code (image->error says from where)
+ */
+static int fexReach(FexImage *image, int codeStart){
+	char *reached = calloc(image->size + 1, 1);
+	int *stack = malloc((image->size + 1) * sizeof(int));
+	int n = 0;
+	int failed = 0;
+
+	if(reached == NULL || stack == NULL){
+		snprintf(image->error, sizeof(image->error), "out of memory");
+		free(reached);
+		free(stack);
+		return -1;
+	}
+	reached[codeStart] = 1;
+	stack[n++] = codeStart;
+	while(n > 0 && !failed){
+		int a = stack[--n];
+		char *inst = image->inst[a];
+		const FexOp *op = fexFindOp(inst[0]);
+		int next = op->target == FEX_NO_ADDR ? a + 1 : a + 2;
+		int to[2];
+		int nTo = 0;
+
+		if(op->target == FEX_BRANCH) to[nTo++] = image->data[a + 1];
+		if(op->op != 'b' && op->op != 'e' && op->op != 'R'){
+			if(next >= image->size){
+				snprintf(image->error, sizeof(image->error), "address %d: %.4s runs past the end of the code", a, inst);
+				failed = 1;
+			}else if(image->kind[next] != FEX_INST){
+				snprintf(image->error, sizeof(image->error), "address %d: %.4s runs into data at %d", a, inst, next);
+				failed = 1;
+			}
+			to[nTo++] = next;
+		}
+		for(int i = 0; i < nTo && !failed; i++){
+			if(reached[to[i]]) continue;
+			reached[to[i]] = 1;
+			stack[n++] = to[i];
+		}
+	}
+	free(reached);
+	free(stack);
+	return failed ? -1 : 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * fexVerify
+ */
+int fexVerify(FexImage *image){
+	int codeStart = image->stackSize + image->heapSize;
+
+	image->verified = 0;
+	if(image->codeSize > 0 && image->kind[codeStart] != FEX_INST){
+		snprintf(image->error, sizeof(image->error), "address %d: the code does not start with an instruction", codeStart);
+		return -1;
+	}
+	for(int a = codeStart; a < image->size; a++){
+		if(image->kind[a] != FEX_INST) continue;
+		char *inst = image->inst[a];
+		const FexOp *op = fexFindOp(inst[0]);
+		if(op == NULL){
+			snprintf(image->error, sizeof(image->error), "address %d: unknown opcode in %.4s", a, inst);
+			return -1;
+		}
+		for(int r = 1; r <= op->regs; r++){
+			if(!isdigit((unsigned char)inst[r])){
+				snprintf(image->error, sizeof(image->error), "address %d: bad register in %.4s", a, inst);
+				return -1;
+			}
+		}
+		if(op->op == 'A' && (inst[3] < '0' || inst[3] > '3')){
+			snprintf(image->error, sizeof(image->error), "address %d: bad hint in %.4s", a, inst);
+			return -1;
+		}
+		if(op->target == FEX_NO_ADDR) continue;
+
+		if(a + 1 >= image->size || image->kind[a + 1] != FEX_DATA){
+			snprintf(image->error, sizeof(image->error), "address %d: %.4s has no address word", a, inst);
+			return -1;
+		}
+		long target = image->data[++a];
+		if(op->target == FEX_BRANCH && (target < codeStart || target >= image->size || image->kind[target] != FEX_INST)){
+			snprintf(image->error, sizeof(image->error), "address %d: %.4s to %ld, not an instruction", a - 1, inst, target);
+			return -1;
+		}
+		if(op->target == FEX_STORE && (target < 0 || target >= codeStart)){
+			snprintf(image->error, sizeof(image->error), "address %d: %.4s to %ld, outside the stack and heap", a - 1, inst, target);
+			return -1;
+		}
+		if(op->target == FEX_LOAD && (target < 0 || target >= image->size)){
+			snprintf(image->error, sizeof(image->error), "address %d: %.4s of %ld, outside the program", a - 1, inst, target);
+			return -1;
+		}
+	}
+	if(image->codeSize > 0 && fexReach(image, codeStart) != 0) return -1;
+	image->verified = 1;
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * fexZeroPage
+ */
+int fexZeroPage(FexImage *image, int page, int pageSize){
+	int start = page * pageSize;
+	int end = start + pageSize;
+
+	if(end > image->stackSize + image->heapSize) return 0;
+	for(int a = start; a < end; a++){
+		if(image->kind[a] == FEX_INST) return 0;
+		if(image->kind[a] == FEX_DATA && image->data[a] != 0) return 0;
+	}
+	return 1;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * fexFree
+ */
+void fexFree(FexImage *image){
+	free(image->kind);
+	free(image->data);
+	free(image->inst);
+	image->kind = NULL;
+	image->data = NULL;
+	image->inst = NULL;
+}
+/*================================================================================*/
@@ -0,0 +1,109 @@
+/*
+ * fex.h
+ * .fex2 program file parser for fos os
+ * Joshua Castelli/Nathan Helmig
+ *
+ * a .fex2 file is
+ *    fex2
+ *    <stack size> comment
+ *    <heap size>  comment
+ *    <code size>  comment
+ *    lines of "<address> <word> comment", '#' lines are comments
+ * a word that starts with a digit is data, anything else is an
+ * instruction (4 characters). addresses not given are left zero.
+ *
+ * like trace.c this does not include computer2.h, so it can use threads
+ */
+
+#ifndef FEX_H
+#define FEX_H
+
+#define FEX_DATA 0
+#define FEX_INST 1
+#define FEX_EMPTY 2
+
+/*
+ * FexImage - a parsed program, indexed by virtual address
+ *    kind[a]    FEX_DATA, FEX_INST or FEX_EMPTY (address not in the file)
+ *    data[a]    value of a data word
+ *    inst[a]    the 4 characters of an instruction word
+ *    verified   fexVerify found nothing wrong with the code
+ *    error      set when parsing or verifying fails (without the file
+ *               name)
+ */
+typedef struct {
+	char *fileName;
+	int stackSize;
+	int heapSize;
+	int codeSize;
+	int size;
+	char *kind;
+	long *data;
+	char (*inst)[5];
+	int verified;
+	char error[128];
+} FexImage;
+
+/*
+ * fexParseFile
+ *    read fileName into image
+ *
+ *    return
+ *       0 success
+ *       -1 failure, image->error says why
+ */
+int fexParseFile(char *fileName, FexImage *image);
+
+/*
+ * fexParseMany
+ *    parse files[0..n-1] into images[0..n-1] on up to 'threads' threads,
+ *    and if verify is set, fexVerify each one on the same thread
+ *
+ *    return
+ *       number of files that failed to parse or verify (their
+ *       image->error says why)
+ */
+int fexParseMany(char *files[], int n, FexImage images[], int threads, int verify);
+
+/*
+ * fexVerify
+ *    check the code of image once, so that it can not fail at run time
+ *    for a reason the file already shows. every instruction word from
+ *    the entry point (stackSize + heapSize) on must have
+ *       - an opcode of frisc2.h, or an extended one (xinst.c)
+ *       - a register digit for each register operand (and for ADVS, a
+ *         hint of 0-3)
+ *       - for opcodes with an address word, that word, holding
+ *            BRAN, BRNN, GOSU   an instruction of the code
+ *            STDM               an address in the stack or the heap
+ *            LODM, STIM, DISM   an address in the program
+ *    data words between instructions are allowed (constants), but
+ *    the entry point must be an instruction and following the code
+ *    from it (branches, GOSU return points, and every instruction but
+ *    BRAN, EXIT and RETU on to the next) must reach only instructions,
+ *    without running past the end of the code
+ *
+ *    return
+ *       0 the image is verified (image->verified is set)
+ *       -1 it is not, image->error says where and why
+ */
+int fexVerify(FexImage *image);
+
+/*
+ * fexZeroPage
+ *    is page (of pageSize words) all stack and heap, with no word the
+ *    file sets to anything but zero? such a page can be zero filled on
+ *    demand instead of loaded
+ *
+ *    return
+ *       1 yes, 0 no
+ */
+int fexZeroPage(FexImage *image, int page, int pageSize);
+
+/*
+ * fexFree
+ *    release the arrays of image
+ */
+void fexFree(FexImage *image);
+
+#endif
@@ -0,0 +1,341 @@
+/*
+ * fexgen.c
+ * synthetic .fex2 workload generator for fos os
+ * Joshua Castelli/Nathan Helmig
+ *
+ * usage: fexgen [options] > prog.fex2
+ *    -pattern p    seq | stride | random | zipf | nested     (default seq)
+ *    -ws words     working set: heap words the accesses touch (default 256)
+ *    -n count      data accesses per pass                      (default 1024)
+ *    -stride s     distance between accesses for stride        (default 8)
+ *    -zipf a       skew of the zipf hot set, a > 0             (default 1.0)
+ *    -writes pct   percent of accesses that are writes         (default 0)
+ *    -depth d      GOSU/PUSH nesting around the accesses       (default 0)
+ *    -loops l      passes over the access sequence             (default 1)
+ *    -inner k      nested: times each row of -row accesses repeats (default 4)
+ *    -row r        nested: accesses per row                    (default 16)
+ *    -seed s       random seed                                 (default 1)
+ *    -initheap     emit a zero for every heap word
+ *
+ * the program is laid out like every .fex2: stack, then heap, then code
+ * at <stack-size> + <heap-size>. accesses are unrolled m/s instructions
+ * with the heap address in the following word; loops count down a
+ * register with DECR and branch back with BRNN while it is not negative
+ */
+
+/**************************************************************
+	#includes
+**************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include "computer2.h"
+
+/**************************************************************
+	#defines
+**************************************************************/
+#define PATTERN_SEQ 0
+#define PATTERN_STRIDE 1
+#define PATTERN_RANDOM 2
+#define PATTERN_ZIPF 3
+#define PATTERN_NESTED 4
+
+#define LOOP_REG '9'
+#define INNER_REG '8'
+#define DATA_REG '1'
+
+/**************************************************************
+	Global Variables
+**************************************************************/
+int pattern = PATTERN_SEQ;
+int workingSet = 256;
+int accesses = 1024;
+int stride = 8;
+double zipfSkew = 1.0;
+int writePct = 0;
+int depth = 0;
+int loops = 1;
+int inner = 4;
+int rowLen = 16;
+unsigned long seed = 1;
+int initHeap = FALSE;
+
+char *patternNames[] = {"seq", "stride", "random", "zipf", "nested"};
+WORD *addrs;            // heap offset of every access, in order
+char *isWrite;          // is access i a write
+char (*code)[5];        // generated code, one word per entry
+WORD *operand;          // value of an address word, when code[i][0] == 0
+int codeLen = 0;
+int codeCap = 0;
+
+/**************************************************************
+	Prototypes
+**************************************************************/
+unsigned long nextRand();
+void makeAccesses();
+void emitInst(char op, char r);
+void emitOperand(WORD value);
+void emitAccesses(int from, int to, int heapBase);
+void emitBody(int heapBase, int codeBase);
+void usage(char *prog);
+
+
+/**************************************************************
+	Functions
+**************************************************************/
+
+
+/****Next Random***********************************************
+	xorshift, so the same seed gives the same program everywhere
+**************************************************************/
+unsigned long nextRand(){
+	seed ^= seed << 13;
+	seed ^= seed >> 7;
+	seed ^= seed << 17;
+	return seed;
+}
+
+/****Make Accesses*********************************************
+	fills addrs/isWrite for one pass of the chosen pattern
+**************************************************************/
+void makeAccesses(){
+	addrs = malloc(accesses * sizeof(WORD));
+	isWrite = malloc(accesses);
+
+	double *cdf = NULL;
+	int *rankToAddr = NULL;
+	if(pattern == PATTERN_ZIPF){
+		/* hot ranks are scattered over the working set */
+		cdf = malloc(workingSet * sizeof(double));
+		rankToAddr = malloc(workingSet * sizeof(int));
+		double sum = 0;
+		for(int k = 0; k < workingSet; k++){
+			sum += 1.0 / pow(k + 1, zipfSkew);
+			cdf[k] = sum;
+			rankToAddr[k] = k;
+		}
+		for(int k = workingSet - 1; k > 0; k--){
+			int j = nextRand() % (k + 1);
+			int t = rankToAddr[k];
+			rankToAddr[k] = rankToAddr[j];
+			rankToAddr[j] = t;
+		}
+		for(int k = 0; k < workingSet; k++) cdf[k] /= sum;
+	}
+
+	for(int i = 0; i < accesses; i++){
+		switch(pattern){
+		case PATTERN_STRIDE:
+			addrs[i] = ((long)i * stride) % workingSet;
+			break;
+		case PATTERN_RANDOM:
+			addrs[i] = nextRand() % workingSet;
+			break;
+		case PATTERN_ZIPF:{
+			double u = (nextRand() % 1000000) / 1000000.0;
+			int lo = 0, hi = workingSet - 1;
+			while(lo < hi){
+				int mid = (lo + hi) / 2;
+				if(cdf[mid] < u) lo = mid + 1;
+				else hi = mid;
+			}
+			addrs[i] = rankToAddr[lo];
+			break;
+		}
+		default:
+			addrs[i] = i % workingSet;
+			break;
+		}
+		isWrite[i] = (int)(nextRand() % 100) < writePct;
+	}
+	free(cdf);
+	free(rankToAddr);
+}
+
+/****Emit******************************************************
+	append an instruction word or an address word to the code
+**************************************************************/
+void emitInst(char op, char r){
+	if(codeLen == codeCap){
+		codeCap = codeCap ? codeCap * 2 : 1024;
+		code = realloc(code, codeCap * sizeof(*code));
+		operand = realloc(operand, codeCap * sizeof(WORD));
+	}
+	code[codeLen][0] = op;
+	code[codeLen][1] = r;
+	code[codeLen][2] = '.';
+	code[codeLen][3] = '.';
+	code[codeLen][4] = 0;
+	operand[codeLen++] = 0;
+}
+
+void emitOperand(WORD value){
+	emitInst(0, 0);
+	operand[codeLen - 1] = value;
+}
+
+/****Emit Accesses*********************************************
+	unrolled loads/stores for accesses [from, to)
+**************************************************************/
+void emitAccesses(int from, int to, int heapBase){
+	for(int i = from; i < to; i++){
+		if(isWrite[i]){
+			emitInst(INCR, DATA_REG);
+			emitInst(STDM, DATA_REG);
+		}else{
+			emitInst(LODM, DATA_REG);
+		}
+		emitOperand(heapBase + addrs[i]);
+	}
+}
+
+/****Emit Body***********************************************
+	one pass of the accesses; for nested, each row of the pass
+	is its own inner loop
+**************************************************************/
+void emitBody(int heapBase, int codeBase){
+	if(pattern != PATTERN_NESTED){
+		emitAccesses(0, accesses, heapBase);
+		return;
+	}
+	for(int row = 0; row < accesses; row += rowLen){
+		int end = row + rowLen < accesses ? row + rowLen : accesses;
+		emitInst(LOIM, INNER_REG);
+		emitOperand(inner - 1);
+		int innerTop = codeLen;
+		emitAccesses(row, end, heapBase);
+		emitInst(DECR, INNER_REG);
+		emitInst(BRNN, '.');
+		emitOperand(codeBase + innerTop);
+	}
+}
+
+/****Usage*****************************************************/
+void usage(char *prog){
+	fprintf(stderr, "Usage: %s [-pattern seq|stride|random|zipf|nested] [-ws words] [-n count]\n"
+	                "       [-stride s] [-zipf a] [-writes pct] [-depth d] [-loops l]\n"
+	                "       [-inner k] [-row r] [-seed s] [-initheap]\n", prog);
+	exit(1);
+}
+
+/****MAIN******************************************************
+	MAIN FUNCTION - writes the generated program to stdout
+**************************************************************/
+int main(int argc, char* argv[]){
+	for(int i = 1; i < argc; i++){
+		if(strcmp(argv[i], "-initheap") == 0){
+			initHeap = TRUE;
+			continue;
+		}
+		if(i + 1 >= argc) usage(argv[0]);
+		char *opt = argv[i];
+		char *val = argv[++i];
+		if(strcmp(opt, "-pattern") == 0){
+			if(strcmp(val, "seq") == 0) pattern = PATTERN_SEQ;
+			else if(strcmp(val, "stride") == 0) pattern = PATTERN_STRIDE;
+			else if(strcmp(val, "random") == 0) pattern = PATTERN_RANDOM;
+			else if(strcmp(val, "zipf") == 0) pattern = PATTERN_ZIPF;
+			else if(strcmp(val, "nested") == 0) pattern = PATTERN_NESTED;
+			else usage(argv[0]);
+		}else if(strcmp(opt, "-ws") == 0){
+			workingSet = atoi(val);
+		}else if(strcmp(opt, "-n") == 0){
+			accesses = atoi(val);
+		}else if(strcmp(opt, "-stride") == 0){
+			stride = atoi(val);
+		}else if(strcmp(opt, "-zipf") == 0){
+			zipfSkew = atof(val);
+		}else if(strcmp(opt, "-writes") == 0){
+			writePct = atoi(val);
+		}else if(strcmp(opt, "-depth") == 0){
+			depth = atoi(val);
+		}else if(strcmp(opt, "-loops") == 0){
+			loops = atoi(val);
+		}else if(strcmp(opt, "-inner") == 0){
+			inner = atoi(val);
+		}else if(strcmp(opt, "-row") == 0){
+			rowLen = atoi(val);
+		}else if(strcmp(opt, "-seed") == 0){
+			seed = strtoul(val, NULL, 10);
+			if(seed == 0) seed = 1;
+		}else{
+			usage(argv[0]);
+		}
+	}
+	if(workingSet <= 0 || accesses <= 0 || loops <= 0 || depth < 0 || inner <= 0
+	   || rowLen <= 0 || stride <= 0 || zipfSkew <= 0){
+		usage(argv[0]);
+	}
+
+	/* a nested pass walks the working set sequentially, row by row */
+	if(pattern == PATTERN_NESTED && accesses < workingSet) accesses = workingSet;
+	makeAccesses();
+
+	/* each call level holds a return address and one pushed register */
+	int stackSize = depth * 2;
+	int heapBase = stackSize;
+	int codeBase = stackSize + workingSet;
+
+	/* main: outer loop around a call to sub 1 (or the accesses when depth is 0) */
+	emitInst(CLER, DATA_REG);
+	emitInst(LOIM, LOOP_REG);
+	emitOperand(loops - 1);
+	int outerTop = codeLen;
+	int callFixup = -1;
+	if(depth > 0){
+		emitInst(GOSU, '.');
+		callFixup = codeLen;
+		emitOperand(0);
+	}else{
+		emitBody(heapBase, codeBase);
+	}
+	emitInst(DECR, LOOP_REG);
+	emitInst(BRNN, '.');
+	emitOperand(codeBase + outerTop);
+	emitInst(EXIT, '.');
+
+	/* subs 1..depth: save a register, call the next level, restore, return */
+	for(int level = 1; level <= depth; level++){
+		operand[callFixup] = codeBase + codeLen;
+		emitInst(PUSH, DATA_REG);
+		if(level < depth){
+			emitInst(GOSU, '.');
+			callFixup = codeLen;
+			emitOperand(0);
+		}else{
+			emitBody(heapBase, codeBase);
+		}
+		emitInst(POP, DATA_REG);
+		emitInst(RETU, '.');
+	}
+
+	int total = codeBase + codeLen;
+	if(total > 9999){
+		fprintf(stderr, "fexgen: %d words, more than the 4 digit addresses reach\n", total);
+		exit(1);
+	}
+
+	printf("fex2\n");
+	printf("%04d first line is the size of the stack\n", stackSize);
+	printf("%04d second line is the size of the heap\n", workingSet);
+	printf("%04d third line is the size of the code\n", codeLen);
+	printf("# generated by fexgen: pattern %s, %d accesses/pass, %d passes, %d%% writes, depth %d\n",
+	       patternNames[pattern], accesses, loops, writePct, depth);
+	if(initHeap){
+		for(int a = 0; a < workingSet; a++){
+			printf("%04d 0000\n", heapBase + a);
+		}
+	}
+	printf("\n# the code starts here\n");
+	for(int i = 0; i < codeLen; i++){
+		if(code[i][0] == 0){
+			printf("%04d %04ld\n", codeBase + i, operand[i]);
+		}else{
+			printf("%04d %s\n", codeBase + i, code[i]);
+		}
+	}
+
+	return 0;
+}
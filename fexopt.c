@@ -0,0 +1,670 @@
+/*
+ * fexopt.c
+ * peephole optimizer for .fex2 programs of fos os
+ * Joshua Castelli/Nathan Helmig
+ *
+ * usage: fexopt prog.fex2 > opt.fex2
+ *    the program is parsed and verified (fex.c), simplified and written
+ *    to stdout with its code moved up over the words removed; what was
+ *    removed is reported on stderr
+ *
+ * the stack and heap are copied as they are. in the code,
+ *    dead code       an instruction with no effect but setting registers
+ *                    (and the psw) that are not read again before they
+ *                    are set, e.g. i1 z1 before m1; NOPs
+ *    peephole        iN rN and rN iN cancel out; lN k followed by iN or
+ *                    rN becomes lN k+1 or lN k-1
+ *    loads           mN A when register N already holds word A (loaded
+ *                    from or stored to it in the same basic block), and
+ *                    sN A in that case
+ *    jumps           a branch or call to a BRAN goes straight to its
+ *                    target; a branch to the next instruction goes
+ *    unreachable     instructions no path from the entry point reaches
+ *                    (after e, or behind a BRAN)
+ * are removed, until none is left. then every branch, call, load and
+ * store address into the code is moved with it. data words in the code
+ * stay, and an instruction whose words the program reads as data is
+ * never touched
+ *
+ * a program that holds an address reaching into its code, in an
+ * immediate or in a data word of its own (say in the heap), and has an
+ * instruction that takes an address from a register (PUSH, STIM, BMOV,
+ * BFIL, ADVS, SPWN) may compute code addresses; its code is not moved,
+ * the words removed are written as NOPs instead, and every instruction
+ * such a word addresses is taken as an entry point (a thread may start
+ * there, or a RETU land there). in a program that starts threads reg[0]
+ * is read by EXIT (it is what a JOIN of the thread gets)
+ *
+ * INCR, DECR and COMP set the psw (BRNN tests it); every other
+ * instruction that sets a register is taken as one that may. dead loads
+ * are removed too: a workload from fexgen that only reads loses its
+ * reads
+ */
+
+/**************************************************************
+	#includes
+**************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "computer2.h"
+#include "fex.h"
+
+/**************************************************************
+	#defines
+**************************************************************/
+#define PSW_BIT (1 << 10)
+#define ALL_LIVE 0x7ff      // every register and the psw
+
+#define FLOW_NEXT 0         // goes on to the next instruction
+#define FLOW_JUMP 1         // BRAN
+#define FLOW_COND 2         // BRNN
+#define FLOW_CALL 3         // GOSU
+#define FLOW_RETURN 4       // RETU
+#define FLOW_STOP 5         // EXIT
+
+#define MAX_HOPS 64         // branches followed when threading a jump
+
+/**************************************************************
+	Types
+**************************************************************/
+/*
+ * OpInfo - what one instruction does, as the passes see it
+ *    use       registers (and psw) it reads
+ *    def       registers (and psw) it sets
+ *    mayDef    registers (and psw) it might set
+ *    pure      removing it changes nothing but those registers
+ *    clobbers  it may write memory the loads pass is tracking
+ */
+typedef struct {
+	int use;
+	int def;
+	int mayDef;
+	int pure;
+	int clobbers;
+	int flow;
+} OpInfo;
+
+/**************************************************************
+	Global Variables
+**************************************************************/
+FexImage image;
+int codeStart;
+char *removed;          // word removed
+char *pinned;           // instruction read as data, never touched
+char *leader;           // instruction some jump, call or return lands on
+char *reached;
+int *liveIn;
+int *liveOut;
+int *newAddr;
+int moveCode = TRUE;    // FALSE: removed words become NOPs in place
+int spawns = FALSE;     // the program starts threads
+
+long nDead = 0;
+long nPeephole = 0;
+long nLoads = 0;
+long nJumps = 0;
+long nUnreachable = 0;
+
+/**************************************************************
+	Prototypes
+**************************************************************/
+int instLen(int a);
+int isInst(int a);
+int follow(int a);
+int regBit(char c);
+OpInfo opInfo(int a);
+void removeInst(int a, long *count);
+int codeAddrWord(int a);
+void checkMoveCode();
+void markPinned();
+int codeEntry(int a);
+void markLeaders();
+int passUnreachable();
+int passJumps();
+void computeLiveness();
+int passDead();
+int passPeephole();
+int passLoads();
+void relocate();
+void writeProgram();
+void usage(char *prog);
+
+
+/**************************************************************
+	Functions
+**************************************************************/
+
+
+/****Instruction Words*****************************************
+	instLen is the number of words of the instruction at a; isInst
+	tells a kept instruction of the code from anything else
+**************************************************************/
+int instLen(int a){
+	return HAS_ADDR_WORD(image.inst[a][0]) ? 2 : 1;
+}
+
+int isInst(int a){
+	return a >= codeStart && a < image.size && image.kind[a] == FEX_INST && !removed[a];
+}
+
+/****Follow****************************************************
+	the first word at or after a that is not removed: where
+	execution that reaches a goes on
+**************************************************************/
+int follow(int a){
+	while(a < image.size && removed[a]){
+		a++;
+	}
+	return a;
+}
+
+/****Register Bit********************************************
+	the bit of register operand c in a live set; only called
+	for operands fexVerify checked are register digits
+**************************************************************/
+int regBit(char c){
+	return 1 << (c - '0');
+}
+
+/****Op Info***************************************************/
+OpInfo opInfo(int a){
+	char *inst = image.inst[a];
+	OpInfo info = {0, 0, 0, FALSE, FALSE, FLOW_NEXT};
+
+	switch(inst[0]){
+	case LODM: case LOIM: case CLER:
+		info.def = regBit(inst[1]);
+		info.mayDef = PSW_BIT;
+		info.pure = TRUE;
+		break;
+	case STDM:
+		info.use = regBit(inst[1]);
+		break;
+	case STIM:
+		info.use = regBit(inst[1]);
+		info.clobbers = TRUE;
+		break;
+	case INCR: case DECR:
+		info.use = regBit(inst[1]);
+		info.def = regBit(inst[1]) | PSW_BIT;
+		info.pure = TRUE;
+		break;
+	case ADDR: case SUBR:
+		info.use = regBit(inst[2]) | regBit(inst[3]);
+		info.def = regBit(inst[1]);
+		info.mayDef = PSW_BIT;
+		info.pure = TRUE;
+		break;
+	case COMP:
+		info.use = regBit(inst[1]) | regBit(inst[2]);
+		info.def = PSW_BIT;
+		info.pure = TRUE;
+		break;
+	case BRAN:
+		info.flow = FLOW_JUMP;
+		break;
+	case BRNN:
+		info.use = PSW_BIT;
+		info.flow = FLOW_COND;
+		break;
+	case DISC:
+		info.use = regBit(inst[1]);
+		break;
+	case DISM:
+		break;
+	case EXIT:
+		info.flow = FLOW_STOP;
+		break;
+	case NOP:
+		info.pure = TRUE;
+		break;
+	case PUSH:
+		info.use = regBit(inst[1]);
+		info.clobbers = TRUE;
+		break;
+	case POP:
+		info.def = regBit(inst[1]);
+		info.mayDef = PSW_BIT;
+		break;
+	case GOSU:
+		info.clobbers = TRUE;
+		info.flow = FLOW_CALL;
+		break;
+	case RETU:
+		info.use = ALL_LIVE;
+		info.flow = FLOW_RETURN;
+		break;
+	case BMOV: case BFIL:
+		info.use = regBit(inst[1]) | regBit(inst[2]) | regBit(inst[3]);
+		info.clobbers = TRUE;
+		break;
+	case ADVS:
+		info.use = regBit(inst[1]) | regBit(inst[2]);
+		info.clobbers = TRUE;
+		break;
+	default:
+		/* TX2N, N2TX, and SPWN and JOIN (a thread starts with a copy of
+		   every register): nothing is moved past them */
+		info.use = ALL_LIVE;
+		info.mayDef = ALL_LIVE;
+		info.clobbers = TRUE;
+		break;
+	}
+	return info;
+}
+
+/****Remove Instruction****************************************/
+void removeInst(int a, long *count){
+	for(int w = 0; w < instLen(a); w++){
+		removed[a + w] = TRUE;
+	}
+	(*count)++;
+}
+
+/****Mark Pinned***********************************************
+	an instruction whose words a load, store or DISM addresses
+	stays as it is
+**************************************************************/
+void markPinned(){
+	for(int a = codeStart; a < image.size; a++){
+		if(image.kind[a] != FEX_INST || !HAS_ADDR_WORD(image.inst[a][0])) continue;
+		char op = image.inst[a][0];
+		long target = image.data[a + 1];
+		if(op != LODM && op != STDM && op != STIM && op != DISM) continue;
+		if(target < codeStart || target >= image.size) continue;
+		if(image.kind[target] == FEX_INST) pinned[target] = TRUE;
+		else if(target > codeStart && image.kind[target - 1] == FEX_INST && HAS_ADDR_WORD(image.inst[target - 1][0])) pinned[target - 1] = TRUE;
+	}
+}
+
+/****Code Address Word***************************************
+	is word a one the program may take a code address from: the
+	immediate of an LOIM, or a data word of its own (not the
+	address word of another instruction), holding an address in
+	the code or just past it
+**************************************************************/
+int codeAddrWord(int a){
+	if(image.kind[a] != FEX_DATA || image.data[a] < codeStart || image.data[a] > image.size) return FALSE;
+	if(a == 0 || image.kind[a - 1] != FEX_INST || !HAS_ADDR_WORD(image.inst[a - 1][0])) return TRUE;
+	return image.inst[a - 1][0] == LOIM;
+}
+
+/****Check Move Code*****************************************
+	clears moveCode if the program may compute code addresses
+**************************************************************/
+void checkMoveCode(){
+	int codeAddr = FALSE;
+	int registerAddr = FALSE;
+
+	for(int a = 0; a < image.size; a++){
+		if(codeAddrWord(a)) codeAddr = TRUE;
+		if(image.kind[a] != FEX_INST) continue;
+		char op = image.inst[a][0];
+		if(op == PUSH || op == STIM || op == BMOV || op == BFIL || op == ADVS || op == SPWN) registerAddr = TRUE;
+		if(op == SPWN) spawns = TRUE;
+	}
+	moveCode = !(codeAddr && registerAddr);
+}
+
+/****Code Entry**********************************************
+	is word a a code address word (codeAddrWord) that may be
+	where a thread starts or a computed jump lands
+**************************************************************/
+int codeEntry(int a){
+	long target = image.data[a];
+	if(moveCode || removed[a] || !codeAddrWord(a)) return FALSE;
+	return target < image.size && image.kind[target] == FEX_INST;
+}
+
+/****Mark Leaders**********************************************
+	the entry point, every code entry, every branch and call
+	target, every return point and every instruction after a
+	data word
+**************************************************************/
+void markLeaders(){
+	memset(leader, FALSE, image.size + 1);
+	leader[follow(codeStart)] = TRUE;
+	for(int a = 0; a < image.size; a++){
+		if(codeEntry(a)) leader[follow(image.data[a])] = TRUE;
+	}
+	for(int a = codeStart; a < image.size; a++){
+		if(removed[a]) continue;
+		if(!isInst(a)){
+			leader[follow(a + 1)] = TRUE;
+			continue;
+		}
+		OpInfo info = opInfo(a);
+		if(info.flow == FLOW_JUMP || info.flow == FLOW_COND || info.flow == FLOW_CALL){
+			leader[follow(image.data[a + 1])] = TRUE;
+		}
+		if(info.flow == FLOW_CALL) leader[follow(a + 2)] = TRUE;
+		a += instLen(a) - 1;
+	}
+}
+
+/****Unreachable***********************************************
+	removes instructions no path from the entry point reaches
+**************************************************************/
+int passUnreachable(){
+	int *stack = malloc(3 * (image.size + 1) * sizeof(int));
+	int n = 0;
+	long before = nUnreachable;
+
+	memset(reached, FALSE, image.size + 1);
+	stack[n++] = follow(codeStart);
+	for(int a = 0; a < image.size; a++){
+		if(codeEntry(a)) stack[n++] = follow(image.data[a]);
+	}
+	while(n > 0){
+		int a = stack[--n];
+		if(!isInst(a) || reached[a]) continue;
+		reached[a] = TRUE;
+		OpInfo info = opInfo(a);
+		if(info.flow == FLOW_JUMP || info.flow == FLOW_COND || info.flow == FLOW_CALL){
+			stack[n++] = follow(image.data[a + 1]);
+		}
+		if(info.flow == FLOW_NEXT || info.flow == FLOW_COND || info.flow == FLOW_CALL){
+			stack[n++] = follow(a + instLen(a));
+		}
+	}
+	for(int a = codeStart; a < image.size; a++){
+		if(!isInst(a)) continue;
+		if(!reached[a] && !pinned[a]) removeInst(a, &nUnreachable);
+		a += instLen(a) - 1;
+	}
+	free(stack);
+	return nUnreachable != before;
+}
+
+/****Jumps*****************************************************
+	threads branches and calls through BRANs, and removes the
+	branches that only go to the next instruction
+**************************************************************/
+int passJumps(){
+	long before = nJumps;
+
+	for(int a = codeStart; a < image.size; a++){
+		if(!isInst(a)) continue;
+		int flow = opInfo(a).flow;
+		if(pinned[a] || (flow != FLOW_JUMP && flow != FLOW_COND && flow != FLOW_CALL)){
+			a += instLen(a) - 1;
+			continue;
+		}
+		int target = follow(image.data[a + 1]);
+		for(int hops = 0; hops < MAX_HOPS && isInst(target) && image.inst[target][0] == BRAN && target != a; hops++){
+			target = follow(image.data[target + 1]);
+		}
+		/* a loop of BRANs is left alone */
+		if(isInst(target) && image.inst[target][0] == BRAN) target = follow(image.data[a + 1]);
+		if(target != image.data[a + 1]){
+			if(target != follow(image.data[a + 1])) nJumps++;
+			image.data[a + 1] = target;
+		}
+		if(flow != FLOW_CALL && target == follow(a + 2)){
+			removeInst(a, &nJumps);
+		}
+		a++;
+	}
+	return nJumps != before;
+}
+
+/****Liveness**************************************************
+	registers (and psw) live before and after every instruction,
+	iterated backwards to a fixed point; anything that is not a
+	kept instruction counts as reading everything. a thread's
+	reg[0] is live at its EXIT
+**************************************************************/
+void computeLiveness(){
+	int changed = TRUE;
+
+	for(int a = 0; a <= image.size; a++){
+		liveIn[a] = ALL_LIVE;
+		liveOut[a] = 0;
+	}
+	for(int a = codeStart; a < image.size; a++){
+		if(isInst(a)) liveIn[a] = 0;
+	}
+	while(changed){
+		changed = FALSE;
+		for(int a = image.size - 1; a >= codeStart; a--){
+			if(!isInst(a)) continue;
+			OpInfo info = opInfo(a);
+			int next = follow(a + instLen(a));
+			int out = 0;
+			switch(info.flow){
+			case FLOW_NEXT: out = liveIn[next]; break;
+			case FLOW_JUMP: out = liveIn[follow(image.data[a + 1])]; break;
+			case FLOW_COND:
+			case FLOW_CALL: out = liveIn[follow(image.data[a + 1])] | liveIn[next]; break;
+			case FLOW_RETURN: out = ALL_LIVE; break;
+			case FLOW_STOP: out = spawns ? 1 << 0 : 0; break;
+			}
+			int in = info.use | (out & ~info.def);
+			if(in != liveIn[a] || out != liveOut[a]){
+				liveIn[a] = in;
+				liveOut[a] = out;
+				changed = TRUE;
+			}
+		}
+	}
+}
+
+/****Dead Code*************************************************
+	removes instructions that only set what is not read again
+**************************************************************/
+int passDead(){
+	long before = nDead;
+
+	computeLiveness();
+	for(int a = codeStart; a < image.size; a++){
+		if(!isInst(a)) continue;
+		OpInfo info = opInfo(a);
+		if(info.pure && !pinned[a] && ((info.def | info.mayDef) & liveOut[a]) == 0){
+			removeInst(a, &nDead);
+		}
+		a += instLen(a) - 1;
+	}
+	return nDead != before;
+}
+
+/****Peephole**************************************************
+	pairs of neighbouring instructions, the second of which no
+	jump lands on
+**************************************************************/
+int passPeephole(){
+	long before = nPeephole;
+
+	computeLiveness();
+	markLeaders();
+	for(int a = codeStart; a < image.size; a++){
+		if(!isInst(a)) continue;
+		int b = follow(a + instLen(a));
+		if(!isInst(b) || leader[b] || pinned[a] || pinned[b] || image.inst[a][1] != image.inst[b][1]){
+			a += instLen(a) - 1;
+			continue;
+		}
+		char first = image.inst[a][0];
+		char second = image.inst[b][0];
+		int step = second == INCR ? 1 : second == DECR ? -1 : 0;
+
+		if(((first == INCR && second == DECR) || (first == DECR && second == INCR)) && !(liveOut[b] & PSW_BIT)){
+			removeInst(a, &nPeephole);
+			removeInst(b, &nPeephole);
+		}else if(first == LOIM && step != 0 && !(liveOut[b] & PSW_BIT)){
+			image.data[a + 1] += step;
+			removeInst(b, &nPeephole);
+		}
+		a += instLen(a) - 1;
+	}
+	return nPeephole != before;
+}
+
+/****Loads*****************************************************
+	within a basic block, the address each register is known to
+	hold the word of; a load of that word again, or a store of it
+	back, is removed
+**************************************************************/
+int passLoads(){
+	long known[10];
+	long before = nLoads;
+
+	computeLiveness();
+	markLeaders();
+	for(int r = 0; r < 10; r++) known[r] = -1;
+	for(int a = codeStart; a < image.size; a++){
+		if(removed[a]) continue;
+		if(!isInst(a) || leader[a]){
+			for(int r = 0; r < 10; r++) known[r] = -1;
+			if(!isInst(a)) continue;
+		}
+		char op = image.inst[a][0];
+		int reg = image.inst[a][1] - '0';
+		OpInfo info = opInfo(a);
+
+		if(op == LODM && !pinned[a] && known[reg] == image.data[a + 1] && !(liveOut[a] & PSW_BIT)){
+			removeInst(a, &nLoads);
+		}else if(op == STDM && !pinned[a] && known[reg] == image.data[a + 1]){
+			removeInst(a, &nLoads);
+		}else if(op == LODM){
+			known[reg] = image.data[a + 1];
+		}else if(op == STDM){
+			for(int r = 0; r < 10; r++){
+				if(known[r] == image.data[a + 1]) known[r] = -1;
+			}
+			known[reg] = image.data[a + 1];
+		}else{
+			for(int r = 0; r < 10; r++){
+				if(info.clobbers || ((info.def | info.mayDef) & (1 << r))) known[r] = -1;
+			}
+		}
+		if(info.flow != FLOW_NEXT){
+			for(int r = 0; r < 10; r++) known[r] = -1;
+		}
+		a += instLen(a) - 1;
+	}
+	return nLoads != before;
+}
+
+/****Relocate**************************************************
+	new address of every word; a removed word goes where
+	execution that reached it goes on. then addresses into the
+	code are moved
+**************************************************************/
+void relocate(){
+	int next = codeStart;
+
+	for(int a = 0; a < codeStart; a++){
+		newAddr[a] = a;
+	}
+	if(!moveCode){
+		for(int a = codeStart; a <= image.size; a++){
+			newAddr[a] = a;
+		}
+		return;
+	}
+	for(int a = codeStart; a < image.size; a++){
+		if(!removed[a]) newAddr[a] = next++;
+	}
+	newAddr[image.size] = next;
+	for(int a = image.size - 1; a >= codeStart; a--){
+		if(removed[a]) newAddr[a] = newAddr[a + 1];
+	}
+
+	for(int a = codeStart; a < image.size; a++){
+		if(!isInst(a)) continue;
+		char op = image.inst[a][0];
+		if(HAS_ADDR_WORD(op) && op != LOIM){
+			long target = image.data[a + 1];
+			if(target >= codeStart && target <= image.size) image.data[a + 1] = newAddr[target];
+		}
+		a += instLen(a) - 1;
+	}
+}
+
+/****Write Program*********************************************/
+void writeProgram(){
+	int oldCode = image.codeSize;
+	int codeSize = newAddr[image.size] - codeStart;
+
+	printf("fex2\n");
+	printf("%04d first line is the size of the stack\n", image.stackSize);
+	printf("%04d second line is the size of the heap\n", image.heapSize);
+	printf("%04d third line is the size of the code\n", codeSize);
+	printf("# optimized by fexopt from %s: code %d -> %d words\n", image.fileName, oldCode, codeSize);
+	for(int a = 0; a < codeStart; a++){
+		if(image.kind[a] == FEX_DATA) printf("%04d %04ld\n", a, image.data[a]);
+		else if(image.kind[a] == FEX_INST) printf("%04d %.4s\n", a, image.inst[a]);
+	}
+	printf("\n# the code starts here\n");
+	for(int a = codeStart; a < image.size; a++){
+		if(removed[a]){
+			if(!moveCode) printf("%04d x... was %.4s\n", a, image.kind[a] == FEX_INST ? image.inst[a] : "data");
+			continue;
+		}
+		if(image.kind[a] == FEX_INST){
+			printf("%04d %.4s was %04d\n", newAddr[a], image.inst[a], a);
+		}else if(image.kind[a] == FEX_DATA){
+			printf("%04d %04ld\n", newAddr[a], image.data[a]);
+		}
+	}
+}
+
+/****Usage*****************************************************/
+void usage(char *prog){
+	fprintf(stderr, "Usage: %s prog.fex2 > opt.fex2\n", prog);
+	exit(1);
+}
+
+/****MAIN******************************************************
+	MAIN FUNCTION - writes the optimized program to stdout
+**************************************************************/
+int main(int argc, char* argv[]){
+	if(argc != 2) usage(argv[0]);
+
+	if(fexParseFile(argv[1], &image) != 0 || fexVerify(&image) != 0){
+		fprintf(stderr, "fexopt: %s: %s\n", argv[1], image.error);
+		exit(1);
+	}
+	codeStart = image.stackSize + image.heapSize;
+
+	removed = calloc(image.size + 1, 1);
+	pinned = calloc(image.size + 1, 1);
+	leader = calloc(image.size + 1, 1);
+	reached = calloc(image.size + 1, 1);
+	liveIn = calloc(image.size + 1, sizeof(int));
+	liveOut = calloc(image.size + 1, sizeof(int));
+	newAddr = calloc(image.size + 1, sizeof(int));
+	if(!removed || !pinned || !leader || !reached || !liveIn || !liveOut || !newAddr){
+		fprintf(stderr, "fexopt: out of memory\n");
+		exit(1);
+	}
+
+	checkMoveCode();
+	markPinned();
+	if(image.codeSize > 0){
+		int changed = TRUE;
+		while(changed){
+			changed = passUnreachable();
+			changed |= passJumps();
+			changed |= passDead();
+			changed |= passPeephole();
+			changed |= passLoads();
+		}
+		/* the code must still start with an instruction */
+		if(follow(codeStart) < image.size && !isInst(follow(codeStart))){
+			strcpy(image.inst[codeStart], "x...");
+			image.kind[codeStart] = FEX_INST;
+			removed[codeStart] = FALSE;
+		}
+	}
+	relocate();
+	writeProgram();
+
+	if(!moveCode) fprintf(stderr, "fexopt: %s: may compute code addresses, removed words left as NOPs\n", argv[1]);
+	fprintf(stderr, "fexopt: %s: code %d -> %d words (dead %ld, peephole %ld, loads %ld, jumps %ld, unreachable %ld)\n",
+	        argv[1], image.codeSize, newAddr[image.size] - codeStart, nDead, nPeephole, nLoads, nJumps, nUnreachable);
+	fexFree(&image);
+	return 0;
+}
@@ -35,6 +35,21 @@ long clock;
 #define GOSU 'S'
 #define RETU 'R'
 
+// extended instructions - not known to the cpu, emulated by the os (xinst.c)
+#define BMOV 'M'    // Mabc: copy reg[c] words from address reg[a] to address reg[b]
+#define BFIL 'F'    // Fabc: fill reg[c] words from address reg[a] with reg[b]
+#define ADVS 'A'    // Aabh: advise the vmm of reg[b] words from address reg[a], h is the hint (vmm.h)
+#define SPWN 'Y'    // Yab.: start a thread at address reg[a]; reg[b] gets its id, the thread a copy of the registers with 0 in reg[b]
+#define JOIN 'J'    // Jab.: wait for thread reg[a] to end; reg[b] gets its reg[0]
+
+// opcodes whose instruction word is followed by an address (or immediate) word
+#define HAS_ADDR_WORD(op) ((op) == LODM || (op) == LOIM || (op) == STDM \
+                        || (op) == STIM || (op) == BRAN || (op) == BRNN \
+                        || (op) == DISM || (op) == GOSU)
+
+// opcodes that read one data word (after the address word, if any)
+#define READS_DATA_WORD(op) ((op) == LODM || (op) == DISM || (op) == POP || (op) == RETU)
+
 typedef union inst {
   WORD w;
   char s[5];
@@ -0,0 +1,13 @@
+/*
+ * hrtime.c
+ * host wall-clock timer for fos os tools
+ */
+
+#include "hrtime.h"
+#include <time.h>
+
+long long hrtimeNow(){
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (long long)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
@@ -0,0 +1,19 @@
+/*
+ * hrtime.h
+ * host wall-clock timer for fos os tools
+ *
+ * computer2.h declares a variable named clock, which collides with the
+ * clock() function of <time.h>; this module is the one place time.h is
+ * used, so nothing that includes computer2.h should include time.h
+ */
+
+#ifndef HRTIME_H
+#define HRTIME_H
+
+/*
+ * hrtimeNow
+ *    return: nanoseconds from a monotonic host clock
+ */
+long long hrtimeNow();
+
+#endif
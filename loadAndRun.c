@@ -11,17 +11,32 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <ctype.h>
+#include <unistd.h>
 
 #include "fos-kernel2.h"
 #include "computer2.h"
 #include "vmm.h"
+#include "prof.h"
+#include "cost.h"
+#include "trace.h"
+#include "xinst.h"
+#include "fex.h"
+#include "proctab.h"
+#include "replay.h"
+#include "scheduler.h"
+#include "tier.h"
+#include "cache.h"
+#include "server.h"
+#include "console.h"
 
 /**************************************************************
 	#defines
 **************************************************************/
 //#define TRUE 1
 //#define FALSE 0
-#define MAX_PROCESS 10
+#define MAX_LOADMANY 1024
+#define VIEW_LINES 64      // rows ps and dpt print unless asked for more
 
 /**************************************************************
 	Global Variables
@@ -29,10 +44,23 @@
 int pid;
 int address;
 int processSize;
-Process pTableEntry[10];
 FILE* progFile;
 int pageSize;
 
+/* programs are verified as they are loaded (see fexVerify) */
+int verifyPrograms = TRUE;
+
+/* job server: the client that submitted each running job (see serve) */
+typedef struct {
+	int pid;
+	long client;
+} ServeJob;
+
+ServeJob *serveJobs = NULL;
+int nServeJobs = 0;
+int capServeJobs = 0;
+long serveJobsDone = 0;
+
 /**************************************************************
 	Prototypes
 **************************************************************/
@@ -41,7 +69,28 @@ void getCommand();
 void ps();
 void runProg();
 void loadProg();
+int loadFile(char *file, char error[128]);
 void dpt();
+void dptSummary();
+void dptRow(int page);
+int viewArgs(char *what, int *first, int *count);
+void profProg();
+void setCost();
+void setTier();
+void setSched();
+void setCache();
+void setConsole();
+void resizeMem();
+void toggleTrace();
+void dumpProg();
+void loadMany();
+int imagePages(FexImage *image, int *backed);
+void writeImage(FexImage *image, int frames[]);
+void loadImage(FexImage *image, Process *entry, int frames[], int newPid);
+void runAll();
+void serve(char *socketPath);
+void serveRequest(long client, char *line, int *shutdown);
+void serveJobDone(Process *process, CPU_STATE state);
 
 
 /**************************************************************
@@ -57,9 +106,9 @@ void initialize(){
 	// prepare to use the FOS kernel
 	initFOSKernel1(pageSize);
 
-	// set values in the process table
-	// second parameter is size of table
-	initProcessTable(pTableEntry, 10);
+	// the process table grows as processes are loaded
+	// entries are set up by the kernel's initProcessTable
+	procTableInit();
 	
 	initVMM();
 	// pid = process ID
@@ -71,9 +120,30 @@ void initialize(){
 	
 	Commands include:
 	load: 		loads a program into memory
+	loadmany:	loads every program named on the rest of the line
+	verify:		toggles verifying programs as they are loaded
 	run:		runs a designated process to termination
-	ps:			displays the process table
-	dpt:		displays the page table
+	runall:		runs every loaded process, round robin
+	asyncio:	toggles asynchronous page faults for runall
+	ps:			displays the process table (ps [first [count]])
+	dpt:		displays a summary of the page table, or its pages
+				(dpt all|resident|dirty|free|PID [first [count]])
+	profile:	toggles the per-PC execution profiler
+	prof:		displays the profile of a designated process
+	cost:		displays simulated cycles, CPI and fault stalls
+	setcost:	changes one latency of the cost model
+	tier:		displays the memory tiers and page migrations
+	settier:	changes one setting of the memory tiers
+	sched:		displays the quantum, context switches and resumes
+	setsched:	changes one setting of the quantum
+	cache:		toggles the I-cache and D-cache model
+	cachestat:	displays cache hit rates and misses per process
+	setcache:	changes the shape and policy of one cache
+	resize:		changes the size of main or secondary memory
+	console:	buffers process output to stdout or files, or not
+	flush:		writes out all buffered process output
+	trace:		starts (or stops) binary event tracing to a file
+	dump:		displays a range of a process's virtual memory
 	osnoise:	toggles the OS debugging output
 	cpunoise:	toggles the CPU debugging output
 	memnoise:	toggles the main memory debugging output
@@ -85,22 +155,46 @@ void initialize(){
 void getCommand(){
 	/* Temporary variables */
 	int commandFound = FALSE;
-	char command[8];
+	char command[32];
 	
 	/* Loops until a valid command is entered */
 	while(commandFound == FALSE){
 		
+		/* diagnostics may have been toggled by the last command */
+		vmmSelectPath();
+		
+		/* buffered process output is out before the prompt */
+		consoleSync();
+		
+		/* a recorded session is checked (or logged) at every prompt */
+		if(replayMode) replayPrompt(clock, pageTableChecksum());
+		
 		/* prompts user for command */
 		printf("Enter a command: ");
-        scanf("%s",command);
+        if(scanf("%31s",command) != 1){
+			/* end of input */
+			exit(0);
+		}
+		if(replayMode) replayCommand(command);
 		
 		/* Directs the program to the proper function based on the command */
 		if(strcmp(command,"exit") == 0){
 			exit(1);
 		}else if(strcmp(command,"load") == 0){
 			loadProg();
+		}else if(strcmp(command,"loadmany") == 0){
+			loadMany();
+		}else if(strcmp(command,"verify") == 0){
+			verifyPrograms = !verifyPrograms;
+			if(verifyPrograms) printf("Program verification on\n");
+			else printf("Program verification off\n");
 		}else if(strcmp(command,"run") == 0){
 			runProg();
+		}else if(strcmp(command,"runall") == 0){
+			runAll();
+		}else if(strcmp(command,"asyncio") == 0){
+			if(toggleAsyncIO()) printf("Asynchronous page faults on\n");
+			else printf("Asynchronous page faults off\n");
 		}else if(strcmp(command,"ps") == 0){
 			ps();
 		}else if(strcmp(command,"osnoise") == 0){
@@ -116,6 +210,41 @@ void getCommand(){
 			toggleVMEMNoise();
 		}else if(strcmp(command,"dpt") == 0){
 			dpt();
+		}else if(strcmp(command,"profile") == 0){
+			toggleProfiler();
+			printf("Profiler toggled\n");
+		}else if(strcmp(command,"prof") == 0){
+			profProg();
+		}else if(strcmp(command,"cost") == 0){
+			costReport();
+		}else if(strcmp(command,"setcost") == 0){
+			setCost();
+		}else if(strcmp(command,"tier") == 0){
+			tierReport();
+		}else if(strcmp(command,"settier") == 0){
+			setTier();
+		}else if(strcmp(command,"sched") == 0){
+			schedReport();
+		}else if(strcmp(command,"setsched") == 0){
+			setSched();
+		}else if(strcmp(command,"cache") == 0){
+			if(toggleCache()) printf("Caches on\n");
+			else printf("Caches off\n");
+		}else if(strcmp(command,"cachestat") == 0){
+			cacheReport();
+		}else if(strcmp(command,"setcache") == 0){
+			setCache();
+		}else if(strcmp(command,"resize") == 0){
+			resizeMem();
+		}else if(strcmp(command,"console") == 0){
+			setConsole();
+		}else if(strcmp(command,"flush") == 0){
+			consoleFlush(-1);
+			consoleSync();
+		}else if(strcmp(command,"trace") == 0){
+			toggleTrace();
+		}else if(strcmp(command,"dump") == 0){
+			dumpProg();
 		}else if(strcmp(command,"noise") == 0){
 			toggleCPUNoise();
 			toggleMEMNoise();
@@ -127,46 +256,335 @@ void getCommand(){
 	}
 }
 
+/****View Arguments******************************************
+	viewArgs reads the rest of a ps or dpt command line: a word
+	(what, dpt only), then the first row to print and the number
+	of rows (VIEW_LINES if not given)
+	
+	returns 0, or -1 if there is no more input
+**************************************************************/
+int viewArgs(char *what, int *first, int *count){
+	char line[128];
+	char *rows = line;
+	int n = 0;
+	
+	*first = 0;
+	*count = VIEW_LINES;
+	if(fgets(line, sizeof(line), stdin) == NULL) return -1;
+	if(what != NULL){
+		what[0] = 0;
+		sscanf(line, "%15s%n", what, &n);
+		rows = line + n;
+	}
+	sscanf(rows, "%d %d", first, count);
+	if(*first < 0) *first = 0;
+	if(*count < 1) *count = VIEW_LINES;
+	return 0;
+}
+
 /****Process State*********************************************
-	ps displays the contents of the process table
+	ps displays the contents of the process table, count rows
+	from row first on (ps [first [count]]), with the pages of
+	each process in virtual memory, main memory and dirty
 **************************************************************/
 void ps(){
 	/* Format of ps: */
-	/* PID	Code	PC */
+	/* PID	Code	PC	Pages	Res	Dirty	Ver */
+	
+	int first, count;
+	int slot = 0;
+	int row = 0;
+	int resident, dirty;
+	Process *entry;
 	
-	int temp = 0;
+	if(viewArgs(NULL, &first, &count) != 0) return;
 	printf("===Process Table===\n");
-	printf("PID\tCode\tPC\n");
-	for(int i = 0;i < 10; i++){
-		if(pTableEntry[i].pid>0){
-			printf("%d\t%d\t%d\n",pTableEntry[i].pid,pTableEntry[i].codeSize,pTableEntry[i].cpu.pc);
-			temp++;
+	printf("PID\tCode\tPC\tPages\tRes\tDirty\tVer\n");
+	while((entry = procTableNext(&slot)) != NULL){
+		if(row >= first && row < first + count){
+			int pages = procTablePageCounts(entry->pid, &resident, &dirty);
+			printf("%d\t%d\t%ld\t%d\t%d\t%d\t%s\n",entry->pid,entry->codeSize,entry->cpu.pc,pages,resident,dirty,
+			       ((ProcEntry*)entry)->verified ? "yes" : "no");
 		}
+		row++;
 	}
-	if(temp == 0){
+	if(procTableCount() == 0){
 		printf("   (EMPTY TABLE)\n");
+	}else if(first > 0 || first + count < row){
+		printf("rows %d-%d of %d processes\n", first, (first + count < row ? first + count : row) - 1, row);
 	}
 	printf("===================\n");
 }
 
 /****Display Page Table(dpt)***********************************
-	dpt displays the conents of the page table
+	dpt displays a summary of the page table, from the counts
+	the vmm keeps (so it does not depend on its size), or rows
+	of it:
+		dpt			the summary
+		dpt all		every secondary page frame
+		dpt resident	the frames in main memory
+		dpt dirty		the frames in main memory that were written
+		dpt free		the free frames
+		dpt PID		the pages of a process, in virtual page order
+	each followed by the first row to print and how many rows
 **************************************************************/
 void dpt(){
+	char what[16];
+	int first, count;
+	int row = 0;
+	int *secPages = NULL;
+	int nPages = 0;
+	
+	if(viewArgs(what, &first, &count) != 0) return;
+	if(what[0] == 0){
+		dptSummary();
+		return;
+	}
+	int byPid = isdigit((unsigned char)what[0]);
+	if(byPid){
+		nPages = procTablePages(atoi(what), &secPages);
+		if(nPages == -1){
+			printf("PID was not found\n");
+			return;
+		}
+	}else if(strcmp(what,"all") != 0 && strcmp(what,"resident") != 0
+	         && strcmp(what,"dirty") != 0 && strcmp(what,"free") != 0){
+		printf("please enter all, resident, dirty, free or a PID\n");
+		return;
+	}
+	
 	/*  Format of dpt: */
 	/*	Page	PID		FREE	vPage 	Dirty 	lastRef		*/
 	printf("=======================Page Table=======================\n");
 	printf("Page\tPID\tFREE\tvPage\tmPage\tDirty\tlastRef\n");
-	for(int i = 0; i < getNumSecPages();i++){
-		if(pageTable[i].free == 0){
-			printf("%d\t%d\t%d\t%d\t%d\t%d\t%d\t\n",i,pageTable[i].pid,pageTable[i].free,pageTable[i].vPage,pageTable[i].mainPageFrame,pageTable[i].dirty,pageTable[i].lastRef);
-		}else{
-			printf("%d\t(EMPTY PAGE)\n",i);
-		}
+	int n = byPid ? nPages : getNumSecPages();
+	for(int r = 0; r < n; r++){
+		int i = byPid ? secPages[r] : r;
+		if(strcmp(what,"resident") == 0 && pageTable[i].mainPageFrame == -1) continue;
+		if(strcmp(what,"dirty") == 0 && pageTable[i].dirty != TRUE) continue;
+		if(strcmp(what,"free") == 0 && pageTable[i].free != TRUE) continue;
+		if(row >= first && row < first + count) dptRow(i);
+		row++;
+	}
+	if(row == 0){
+		printf("   (NO PAGES)\n");
+	}else if(first > 0 || first + count < row){
+		printf("rows %d-%d of %d", first, (first + count < row ? first + count : row) - 1, row);
+		if(first + count < row) printf(" (dpt %s %d %d for more)", what, first + count, count);
+		printf("\n");
 	}
 	printf("========================================================\n");
 }
 
+/****Page Table Row*******************************************
+	dptRow prints the record of one secondary page frame
+**************************************************************/
+void dptRow(int i){
+	if(i == vmmZeroPage){
+		printf("%d\t(ZERO PAGE)\t\t%d\n",i,pageTable[i].mainPageFrame);
+	}else if(pageTable[i].free == 0){
+		printf("%d\t%d\t%d\t%d\t%d\t%d\t%d\t\n",i,pageTable[i].pid,pageTable[i].free,pageTable[i].vPage,pageTable[i].mainPageFrame,pageTable[i].dirty,pageTable[i].lastRef);
+	}else{
+		printf("%d\t(EMPTY PAGE)\n",i);
+	}
+}
+
+/****Page Table Summary***************************************
+	dptSummary prints the page table counts and the pages of
+	the first VIEW_LINES processes
+**************************************************************/
+void dptSummary(){
+	int slot = 0;
+	int row = 0;
+	int resident, dirty;
+	Process *entry;
+	int used = getNumSecPages() - vmmCounts.free;
+	
+	printf("====================Page Table Summary====================\n");
+	printf("secondary frames %d: used %d, free %d in %d extents\n",
+	       getNumSecPages(), used, vmmCounts.free, vmmCounts.freeExtents);
+	printf("main frames %d: used %d\n", getNumMainPages(), vmmCounts.resident);
+	printf("pages resident %d, not resident %d, dirty %d\n",
+	       vmmCounts.resident, used - vmmCounts.resident, vmmCounts.dirty);
+	printf("zero filled on demand: %ld pages\n", vmmZeroFills);
+	printf("stack window: %ld hits, %ld moves\n", vmmStackHits, vmmStackMoves);
+	printf("PID\tPages\tRes\tDirty\n");
+	while((entry = procTableNext(&slot)) != NULL && row < VIEW_LINES){
+		int pages = procTablePageCounts(entry->pid, &resident, &dirty);
+		printf("%d\t%d\t%d\t%d\n", entry->pid, pages, resident, dirty);
+		row++;
+	}
+	if(procTableCount() == 0){
+		printf("   (NO PROCESSES)\n");
+	}else if(procTableCount() > row){
+		printf("... %d more processes (ps %d)\n", procTableCount() - row, row);
+	}
+	printf("==========================================================\n");
+}
+
+/****Profile Program*****************************************
+	profProg asks the user for a PID and displays its hot PCs,
+	loops and folded call stacks
+**************************************************************/
+void profProg(){
+	int tempPID = -1;
+	
+	/* Ask user for PID to display */
+	printf("Enter a PID to profile: ");
+	scanf("%d",&tempPID);
+	
+	profReport(tempPID, PROF_TOP_N);
+}
+
+/****Set Cost************************************************
+	setCost asks the user for a latency name and its new value
+	in simulated cycles
+**************************************************************/
+void setCost(){
+	char name[16];
+	long value = -1;
+	
+	printf("Enter a latency (inst, mem, slowmem, fault, secread, writeback, migrate, cachehit, switch) and cycles: ");
+	scanf("%15s %ld",name,&value);
+	
+	if(costSet(name, value) != 0){
+		printf("please enter a valid latency and a non-negative value\n");
+	}
+}
+
+/****Set Tier************************************************
+	setTier changes the size of the fast tier, the pages the
+	migration engine may move per epoch or the quanta per epoch
+**************************************************************/
+void setTier(){
+	char name[16];
+	int value = -1;
+	
+	printf("Enter a tier setting (fast, budget, period) and value: ");
+	scanf("%15s %d",name,&value);
+	
+	if(tierSet(name, value) != 0){
+		printf("please enter a valid setting and value\n");
+	}
+}
+
+/****Set Sched***********************************************
+	setSched turns the adaptive quantum on or off, or changes
+	the quantum (its longest, if adaptive) in cpu slices
+**************************************************************/
+void setSched(){
+	char name[16];
+	int value = -1;
+	
+	printf("Enter a scheduler setting (adaptive, slices) and value: ");
+	scanf("%15s %d",name,&value);
+	
+	if(schedSet(name, value) != 0){
+		printf("please enter adaptive 0 or 1, or slices of at least 1\n");
+	}
+}
+
+/****Set Cache***********************************************
+	setCache asks for a cache, its size and associativity, its
+	line size in words and its replacement policy
+**************************************************************/
+void setCache(){
+	char which[4];
+	char policy[8];
+	CacheConfig config = {-1, -1, -1, -1};
+	
+	printf("Enter a cache (i, d), size, associativity, line size and policy (lru, fifo, random): ");
+	scanf("%3s %d %d %d %7s",which,&config.size,&config.assoc,&config.line,policy);
+	config.policy = cachePolicy(policy);
+	
+	int cache = strcmp(which,"i") == 0 ? CACHE_I : strcmp(which,"d") == 0 ? CACHE_D : -1;
+	if(cacheSet(cache, config) != 0){
+		printf("please enter i or d, a size that is a multiple of associativity * line size, and a policy\n");
+	}
+}
+
+/****Resize Memory*******************************************
+	resizeMem asks for main or secondary memory and its new size
+	in words; loaded processes keep running with their pages
+**************************************************************/
+void resizeMem(){
+	char which[8];
+	int words = -1;
+	char error[128];
+	int result;
+	
+	printf("Enter a memory (main, sec) and its new size in words: ");
+	scanf("%7s %d",which,&words);
+	
+	if(strcmp(which,"main") == 0){
+		result = vmmResizeMain(words, error);
+	}else if(strcmp(which,"sec") == 0){
+		result = vmmResizeSec(words, error);
+	}else{
+		printf("please enter main or sec\n");
+		return;
+	}
+	if(result != 0){
+		printf("cannot resize %s memory: %s\n", which, error);
+	}else{
+		printf("main memory %d pages, secondary memory %d pages\n", getNumMainPages(), getNumSecPages());
+	}
+}
+
+/****Set Console*********************************************
+	setConsole asks where process output goes: straight to
+	stdout (off), buffered to stdout, or buffered to one file
+	per process (files)
+**************************************************************/
+void setConsole(){
+	char mode[8];
+	
+	printf("Enter console output (off, stdout, files): ");
+	scanf("%7s",mode);
+	
+	if(consoleSetMode(mode) != 0){
+		printf("please enter off, stdout or files\n");
+	}
+	consoleReport();
+}
+
+/****Toggle Trace********************************************
+	toggleTrace asks for a file and starts tracing to it, or
+	stops the trace that is running
+**************************************************************/
+void toggleTrace(){
+	char fileName[64];
+	
+	if(traceEnabled){
+		long dropped = traceStop();
+		printf("Trace stopped: %ld events written, %ld dropped\n", traceEventsWritten(), dropped);
+		return;
+	}
+	
+	printf("Enter a trace file name: ");
+	scanf("%63s",fileName);
+	if(traceStart(fileName) != 0){
+		printf("failed to start trace\n");
+	}else{
+		printf("Tracing to %s\n", fileName);
+	}
+}
+
+/****Dump Program********************************************
+	dumpProg asks for a PID, a virtual address and a number of
+	words, and displays that range of the process's memory
+**************************************************************/
+void dumpProg(){
+	int tempPID = -1;
+	long vAddr = -1;
+	long words = 0;
+	
+	printf("Enter a PID, start address and number of words: ");
+	scanf("%d %ld %ld",&tempPID,&vAddr,&words);
+	
+	vmmDump(tempPID, vAddr, words);
+}
+
 /****Run Program***********************************************
 	runProg asks the user for a PID to run until termination
 **************************************************************/
@@ -174,7 +592,7 @@ void runProg(){
 	
 	/* Local Variables */
 	int tempPID=-1;
-	int tempIndex = -1;
+	Process *entry;
 	
 	/* Ask user for PID to run*/ 
 	printf("Enter a PID to run: ");
@@ -186,17 +604,11 @@ void runProg(){
 		runProg();
 	}
 	
-	/* Searches for PID in process table and saves its index */
-	for(int i = 0; i < 10; i++){
-		int found = -1;
-		if(pTableEntry[i].pid == tempPID && found == -1){
-			tempIndex = i;
-			found = 0;
-		}
-	}
+	/* Looks the PID up in the process table */
+	entry = procTableFind(tempPID);
 	
 	/* If process wasn't found in process table, returns to command prompt */
-	if(tempIndex == -1){
+	if(entry == NULL){
 		printf("PID was not found\n");
 		getCommand();
 	}
@@ -207,30 +619,30 @@ void runProg(){
 	/***************DEBUG************************/
 	/*info about the process that is about to run.*/
 	if(VMEM_NOISE){
-		printf("tempIndex %d\n",tempIndex);						//the processes index in pTableEntry
-		printf("pTable.pid %d\n",pTableEntry[tempIndex].pid);	//the PID of the process
-		for(int i = 0; i < 10; i++){							//contents of pTableEntry
-			printf("pTableEntry.pid: %d\n",pTableEntry[i].pid);
-		}
+		printf("entry.pid %d\n",entry->pid);					//the PID of the process
+		printf("processes: %d\n",procTableCount());			//number of loaded processes
 	}
 	/********************************************/
 	
-	/* Process will run to completion  */
-	while(startProcess(&pTableEntry[tempIndex]) == CLOCK_TICK) {
-		if(VMEM_NOISE) printf("Saving state\n");
-		saveProcessState(&pTableEntry[tempIndex]);
-	}
-	
-	/* The page table is cleaned up after a process is terminated */
-	if(VMEM_NOISE) printf("PROCESS %d TERMINATED\n", pTableEntry[tempIndex].pid);
-	pageTableProcessTerm(pTableEntry[tempIndex].pid);
-	pTableEntry[tempIndex].pid = 0;
+	/* Process and the threads it starts run to completion, one quantum at a time; faults are synchronous */
+	/* The page table is cleaned up after the process is terminated */
+	schedRun(entry);
 	
 	
 	/*Return to command prompt */
 	getCommand();
 }
 
+/****Run All***************************************************
+	runAll runs every loaded process to termination, switching
+	at each quantum (and at each page fault if asyncio is on)
+**************************************************************/
+void runAll(){
+	long before = simCycles;
+	int count = schedRunAll();
+	printf("ran %d processes in %ld simulated cycles\n", count, simCycles - before);
+}
+
 /****Load Program**********************************************
 	loadProg prompts for a filename of a program from the user
 	and attempts to load the file into secondary memory.
@@ -238,93 +650,420 @@ void runProg(){
 void loadProg(){
 	/* Temporary variables */
 	char fileName[30];
-	
-	FILE* progFile;
-	Process* ptEntry = NULL;
+	char error[128];
 	
 	/* Prompts user for filename */
 	printf("enter a file name:");
 	scanf("%s",fileName);
 	
-	/* Searches process table for empty slot and saves the address of the empty slot to ptEntry */ 
-	for(int ptEntryIndex = 0; ptEntryIndex < MAX_PROCESS && ptEntry == NULL; ptEntryIndex++){
-		if(pTableEntry[ptEntryIndex].valid == FALSE){
-			ptEntry = &pTableEntry[ptEntryIndex];
-		}
+	/* Loads the file designated by the user (or its recorded copy) */
+	if(loadFile(replayFile(fileName), error) == -1){
+		printf("%s\n", error);
 	}
 	
-	/* Opens the file designated by the user */
-	progFile = openProgFile(fileName,ptEntry);
+	/* When fully loaded to secondary memory, returns to command prompt */
+	getCommand();
+}
+
+/****Load File***********************************************
+	loadFile loads the program in file into secondary memory
+	as a new process. Stack and heap pages the file leaves zero
+	are not loaded, they map to the zero page until the program
+	writes them.
+	return: the PID of the process, or -1 with why in error
+**************************************************************/
+int loadFile(char *file, char error[128]){
+	/* Temporary variables */
+	FILE* progFile;
+	Process* ptEntry = NULL;
+	FexImage image;
+	int pages, backed;
+	int *frames;
 	
-	/* On failure to open file, returns to command prompt with error */
-	if(progFile == NULL){
-		printf("failed to load\n");
-		getCommand();
+	/* Takes a free entry from the process table */
+	ptEntry = procTableAlloc();
+	if(ptEntry == NULL){
+		snprintf(error, 128, "failed to load, out of memory");
+		return -1;
 	}
 	
-	/* Calculates the size of the process trying to load */
-	processSize = ptEntry->codeSize 
-				   + ptEntry->heapSize 
-				   + ptEntry->stackSize;
-	
+	/* The kernel sets up the entry from the header of the file */
+	progFile = openProgFile(file,ptEntry);
 	
+	/* On failure to open file, returns with error */
+	if(progFile == NULL){
+		snprintf(error, 128, "failed to load");
+		procTableFree(ptEntry);
+		return -1;
+	}
+	fclose(progFile);
+	if(fexParseFile(file, &image) != 0){
+		snprintf(error, 128, "failed to load: %.100s", image.error);
+		procTableFree(ptEntry);
+		return -1;
+	}
 	
-	/* Checks how many pages in secondary memory are FREE */
-	int emptyPages = 0;
-	for(int i = 0; i < getNumSecPages(); i++){
-		if(pageTable[i].free == TRUE){
-			emptyPages++;
-		}
+	/* A malformed program is turned away now instead of failing as it runs */
+	if(verifyPrograms && fexVerify(&image) != 0){
+		snprintf(error, 128, "failed to load: %.100s", image.error);
+		fexFree(&image);
+		procTableFree(ptEntry);
+		return -1;
 	}
 	
+	/* Calculates the size of the process trying to load */
+	processSize = image.size;
+	pages = imagePages(&image, &backed);
+	
 	/* DEBUGGING ONLY Info about process and secondary memory */
 	if(VMEM_NOISE) printf("processSIZE: %d words\n", processSize);
-	if(VMEM_NOISE) printf("codeSIZE: %d words\n",ptEntry->codeSize);
-	if(VMEM_NOISE) printf("heapSIZE: %d words\n",ptEntry->heapSize);
-	if(VMEM_NOISE) printf("stackSIZE: %d words\n",ptEntry->stackSize);
-	if(VMEM_NOISE) printf("Pages left in SecondaryMEM: %d\n",emptyPages);
-	if(VMEM_NOISE) printf("Pages needed for process: %d\n", processSize/getPageSize());
+	if(VMEM_NOISE) printf("codeSIZE: %d words\n",image.codeSize);
+	if(VMEM_NOISE) printf("heapSIZE: %d words\n",image.heapSize);
+	if(VMEM_NOISE) printf("stackSIZE: %d words\n",image.stackSize);
+	if(VMEM_NOISE) printf("Pages needed for process: %d (%d zero filled on demand)\n", backed, pages - backed);
 	
 	/* 
-		If there are no free pages in secondary memory or process size 
-		is larger than the empty space in secondary memory returns to 
-		command prompt with error.
+		If there are not enough free pages in secondary memory for
+		the pages that hold something, returns with error.
 	*/
-	if(emptyPages ==  0){
-		printf("Cannot load file, secondary memory is full\n");
-		getCommand();
-	}else if(emptyPages*getPageSize() <= processSize){
-		printf("Cannot load file, not enough space in secondary memory\n");
-		getCommand();
-	}else{
-		if(VMEM_NOISE) printf("ProcessSize < remaining sMEM, loading process...\n");
+	frames = malloc((backed + 1) * sizeof(int));
+	if(frames == NULL || pageTableReserveSecPages(backed, frames) != 0){
+		snprintf(error, 128, "Cannot load file, not enough space in secondary memory");
+		free(frames);
+		fexFree(&image);
+		procTableFree(ptEntry);
+		return -1;
 	}
 	
-	FILE* notFullyLoaded = progFile;
-	int vPage = 0;
-	/* Loops until process is full loaded into secondary memory */
-	do{
-		int pageFrame;
-		
-		/* Finds a free page in secondary memory */
-		pageFrame = pageTableGetFreeSecPage();
-		
-		/* On failure to find secondary page, returns to command prompt with error */
-		if(pageFrame == -1){
-			printf("failed to find secondary page, sMEM possibly full\n");
-			getCommand();
+	/* Writes the program to secondary memory and registers it */
+	writeImage(&image, frames);
+	pid++;
+	loadImage(&image, ptEntry, frames, pid);
+	if(traceEnabled) traceEmit(TRACE_LOAD, pid, pages, image.codeSize);
+	free(frames);
+	fexFree(&image);
+	return pid;
+}
+
+/****Image Pages*********************************************
+	imagePages returns the number of pages of a parsed program
+	and sets backed to how many of them need a secondary frame;
+	the others are zero filled on demand
+**************************************************************/
+int imagePages(FexImage *image, int *backed){
+	int pages = (image->size + getPageSize() - 1) / getPageSize();
+	
+	*backed = 0;
+	for(int vPage = 0; vPage < pages; vPage++){
+		if(!fexZeroPage(image, vPage, getPageSize())) (*backed)++;
+	}
+	return pages;
+}
+
+/****Write Image*********************************************
+	writeImage writes a parsed program to the secondary frames
+	reserved for it (frames, one per backed page, in order).
+	Nothing is mapped until loadImage commits the frames.
+**************************************************************/
+void writeImage(FexImage *image, int frames[]){
+	int pages = (image->size + getPageSize() - 1) / getPageSize();
+	int f = 0;
+	
+	for(int vPage = 0; vPage < pages; vPage++){
+		if(fexZeroPage(image, vPage, getPageSize())) continue;
+		int base = frames[f++] * getPageSize();
+		for(int w = 0; w < getPageSize(); w++){
+			int a = vPage * getPageSize() + w;
+			if(a < image->size && image->kind[a] == FEX_INST){
+				writeInstToSec(base + w, image->inst[a]);
+			}else if(a < image->size){
+				writeDataToSec(base + w, image->data[a]);
+			}else{
+				writeDataToSec(base + w, 0);
+			}
 		}
+	}
+}
+
+/****Load Image**********************************************
+	loadImage registers a program written by writeImage as
+	process newPid: its frames go into the page table in page
+	order, and zero filled pages map to the shared zero page.
+**************************************************************/
+void loadImage(FexImage *image, Process *entry, int frames[], int newPid){
+	int pages = (image->size + getPageSize() - 1) / getPageSize();
+	int f = 0;
+	
+	procTableAdd(entry, newPid);
+	for(int vPage = 0; vPage < pages; vPage++){
+		if(fexZeroPage(image, vPage, getPageSize())){
+			pageTableMapZeroPage(newPid);
+			continue;
+		}
+		pageTableCommitSecPages(&frames[f++], 1, newPid);
+	}
+	entry->valid = TRUE;
+	entry->state = PROCESS_READY;
+	entry->stackSize = image->stackSize;
+	entry->heapSize = image->heapSize;
+	entry->codeSize = image->codeSize;
+	entry->cpu.pid = newPid;
+	entry->cpu.pc = image->stackSize + image->heapSize;
+	((ProcEntry*)entry)->verified = image->verified;
+}
+
+/****Load Many***********************************************
+	loadMany loads every file named on the rest of the command
+	line (at most MAX_LOADMANY). The files are parsed and
+	verified on a pool of threads, then a process table entry
+	and secondary frames are reserved for each and its words
+	written to them, and only then are the page table and
+	process table entries committed, in one short pass (see
+	writeImage and loadImage).
+**************************************************************/
+void loadMany(){
+	char *line = NULL;
+	size_t lineCap = 0;
+	char *names[MAX_LOADMANY];
+	char *files[MAX_LOADMANY];
+	int nFiles = 0;
+	
+	/* the file names follow the command, or are asked for */
+	if(getline(&line, &lineCap, stdin) == -1){
+		free(line);
+		return;
+	}
+	if(strspn(line, " \t\n") == strlen(line)){
+		printf("enter file names:");
+		if(getline(&line, &lineCap, stdin) == -1){
+			free(line);
+			return;
+		}
+	}
+	for(char *tok = strtok(line, " \t\n"); tok != NULL; tok = strtok(NULL, " \t\n")){
+		if(nFiles == MAX_LOADMANY){
+			printf("loadmany takes at most %d files, nothing loaded\n", MAX_LOADMANY);
+			free(line);
+			return;
+		}
+		names[nFiles] = tok;
+		files[nFiles++] = replayFile(tok);
+	}
+	if(nFiles == 0){
+		free(line);
+		return;
+	}
+	
+	/* Step 1: parse and verify every file in parallel */
+	FexImage *images = calloc(nFiles, sizeof(FexImage));
+	int *frames[MAX_LOADMANY];
+	int pages[MAX_LOADMANY];
+	int backed[MAX_LOADMANY];
+	Process *ptEntry[MAX_LOADMANY];
+	long threads = sysconf(_SC_NPROCESSORS_ONLN);
+	fexParseMany(files, nFiles, images, threads > 0 ? threads : 1, verifyPrograms);
+	
+	/* Step 2: reserve a process table entry and secondary frames for each */
+	for(int f = 0; f < nFiles; f++){
+		ptEntry[f] = NULL;
+		frames[f] = NULL;
+		if(images[f].error[0] != 0){
+			printf("failed to load %s: %s\n", names[f], images[f].error);
+			continue;
+		}
+		ptEntry[f] = procTableAlloc();
+		if(ptEntry[f] == NULL){
+			printf("failed to load %s: out of memory\n", names[f]);
+			continue;
+		}
+		pages[f] = imagePages(&images[f], &backed[f]);
+		frames[f] = malloc((backed[f] + 1) * sizeof(int));
+		if(frames[f] == NULL || pageTableReserveSecPages(backed[f], frames[f]) != 0){
+			printf("failed to load %s: not enough space in secondary memory\n", names[f]);
+			procTableFree(ptEntry[f]);
+			ptEntry[f] = NULL;
+		}
+	}
+	
+	/* Step 3: the kernel sets up each entry as for load, and the words are written */
+	for(int f = 0; f < nFiles; f++){
+		if(ptEntry[f] == NULL) continue;
+		FILE *progFile = openProgFile(files[f], ptEntry[f]);
+		if(progFile == NULL){
+			printf("failed to load %s\n", names[f]);
+			pageTableReleaseSecPages(frames[f], backed[f]);
+			procTableFree(ptEntry[f]);
+			ptEntry[f] = NULL;
+			continue;
+		}
+		fclose(progFile);
+		writeImage(&images[f], frames[f]);
+	}
+	
+	/* Step 4: commit page table and process table entries */
+	int loaded = 0;
+	for(int f = 0; f < nFiles; f++){
+		if(ptEntry[f] == NULL) continue;
+		pid++;
+		loadImage(&images[f], ptEntry[f], frames[f], pid);
+		if(traceEnabled) traceEmit(TRACE_LOAD, pid, pages[f], images[f].codeSize);
+		if(OS_NOISE) printf("loaded %s as PID %d\n", names[f], pid);
+		loaded++;
+	}
+	
+	for(int f = 0; f < nFiles; f++){
+		free(frames[f]);
+		fexFree(&images[f]);
+	}
+	free(images);
+	free(line);
+	printf("loaded %d of %d programs\n", loaded, nFiles);
+}
+
+/****Serve***************************************************
+	serve runs FOS as a job server on the Unix domain socket
+	socketPath instead of reading commands, so memory is made
+	and the VMM set up once for any number of jobs. Requests
+	are lines of text (see serveRequest). Every job submitted
+	while a batch runs, or while the server waits, goes into
+	the next batch, which is run round robin as by runall.
+**************************************************************/
+void serve(char *socketPath){
+	char line[SERVER_LINE];
+	long client;
+	int shutdown = FALSE;
+	
+	if(serverOpen(socketPath) != 0){
+		fprintf(stderr, "cannot listen on %s\n", socketPath);
+		exit(1);
+	}
+	schedExitHook = serveJobDone;
+	fprintf(stderr, "FOS serving on %s\n", socketPath);
+	
+	while(!shutdown || nServeJobs > 0){
+		/* take every request there is, waiting only if there is no work */
+		serverWait(nServeJobs > 0 || shutdown ? 0 : -1);
+		while(serverNextRequest(&client, line)){
+			serveRequest(client, line, &shutdown);
+		}
+		vmmSelectPath();
 		
-		/* Updates the page table to reflect the loading of a page into secondary memory */
-		pageTableLoadProcessToSecFrame(pageFrame, (pid)+1);
-		pageTable[pageFrame].vPage = vPage++;
-		
-		/* Loads a page of the program to the free page found in secondary memory */
-		notFullyLoaded = loadProgFileToPage(progFile,ptEntry,pageFrame,&pid);
-	}while(notFullyLoaded != NULL);
+		/* run the batch; each job is reported as soon as it ends */
+		if(nServeJobs > 0){
+			schedRunAll();
+			fflush(stdout);
+		}
+	}
+	serverClose();
+}
+
+/****Serve Request*******************************************
+	serveRequest carries out one request line of a client:
+		job <file>	load file as a new process for the next batch
+				replies "queued <pid>", and later
+				"done <pid> state <end|badinstr|buserror>
+				inst <n> cycles <n> faults <n> wbacks <n>"
+		stats		replies "stats jobs <done> queued <n>
+				cycles <n> idle <n> zerofills <n>"
+		asyncio		toggles asynchronous page faults
+		console <mode>	buffers job output (off, stdout, files: pid<PID>.out)
+		resize <main|sec> <words>
+				resizes memory between batches; replies
+				"resized main <pages> sec <pages>"
+		quit		closes the connection
+		shutdown	stops the server once queued jobs are done
+	anything else is answered with "error <why>"
+**************************************************************/
+void serveRequest(long client, char *line, int *shutdown){
+	char command[16];
+	char file[SERVER_LINE];
+	char error[128];
 	
-	/* When fully loaded to secondary memory, returns to command prompt */
-	getCommand();
+	if(sscanf(line, "%15s", command) != 1) return;
+	if(strcmp(command,"job") == 0){
+		if(sscanf(line, "%*s %1023s", file) != 1){
+			serverReply(client, "error job needs a file");
+			return;
+		}
+		if(*shutdown){
+			serverReply(client, "error shutting down");
+			return;
+		}
+		int newPid = loadFile(file, error);
+		if(newPid == -1){
+			serverReply(client, "error %s", error);
+			return;
+		}
+		if(nServeJobs == capServeJobs){
+			capServeJobs = capServeJobs ? capServeJobs * 2 : 64;
+			serveJobs = realloc(serveJobs, capServeJobs * sizeof(ServeJob));
+			if(serveJobs == NULL){
+				fprintf(stderr, "out of memory\n");
+				exit(1);
+			}
+		}
+		serveJobs[nServeJobs].pid = newPid;
+		serveJobs[nServeJobs].client = client;
+		nServeJobs++;
+		serverReply(client, "queued %d", newPid);
+	}else if(strcmp(command,"stats") == 0){
+		serverReply(client, "stats jobs %ld queued %d cycles %ld idle %ld zerofills %ld",
+		            serveJobsDone, nServeJobs, simCycles, idleCycles, vmmZeroFills);
+	}else if(strcmp(command,"asyncio") == 0){
+		serverReply(client, "asyncio %s", toggleAsyncIO() ? "on" : "off");
+	}else if(strcmp(command,"console") == 0){
+		if(sscanf(line, "%*s %15s", command) != 1 || consoleSetMode(command) != 0){
+			serverReply(client, "error console needs off, stdout or files");
+			return;
+		}
+		serverReply(client, "console %s", command);
+	}else if(strcmp(command,"resize") == 0){
+		char which[8];
+		int words = -1;
+		int result = -1;
+		if(sscanf(line, "%*s %7s %d", which, &words) != 2){
+			serverReply(client, "error resize needs main or sec and a size in words");
+			return;
+		}
+		if(strcmp(which,"main") == 0) result = vmmResizeMain(words, error);
+		else if(strcmp(which,"sec") == 0) result = vmmResizeSec(words, error);
+		else snprintf(error, 128, "resize needs main or sec");
+		if(result != 0){
+			serverReply(client, "error %s", error);
+			return;
+		}
+		serverReply(client, "resized main %d sec %d", getNumMainPages(), getNumSecPages());
+	}else if(strcmp(command,"quit") == 0){
+		serverDisconnect(client);
+	}else if(strcmp(command,"shutdown") == 0){
+		*shutdown = TRUE;
+		serverReply(client, "shutdown after %d jobs", nServeJobs);
+	}else{
+		serverReply(client, "error unknown request %s", command);
+	}
+}
+
+/****Serve Job Done******************************************
+	serveJobDone is called by the scheduler as each job ends
+	and tells the client that submitted it
+**************************************************************/
+void serveJobDone(Process *process, CPU_STATE state){
+	char *states[] = {"tick", "end", "badinstr", "buserror"};
+	long cycles = 0, inst = 0, faults = 0, wbacks = 0;
+	
+	for(int j = 0; j < nServeJobs; j++){
+		if(serveJobs[j].pid != process->pid) continue;
+		costProcess(process->pid, &cycles, &inst, &faults, &wbacks);
+		/* the job's output is all written before the client hears it is done */
+		consoleClose(process->pid);
+		consoleSync();
+		fflush(stdout);
+		serverReply(serveJobs[j].client, "done %d state %s inst %ld cycles %ld faults %ld wbacks %ld",
+		            process->pid, states[state], inst, cycles, faults, wbacks);
+		serveJobs[j] = serveJobs[--nServeJobs];
+		serveJobsDone++;
+		return;
+	}
 }
 
 /****MAIN******************************************************
@@ -332,16 +1071,34 @@ void loadProg(){
 **************************************************************/
 int main(int argc, char* argv[]){
 	
-	/* User must provide three commandline arguments for main and secondary memory. */ 
-	if(argc != 4) {
-		fprintf(stderr, "Usage: %s mainMemorySize secondaryMemorySize pageSize\n", argv[0]);
+	char **args = &argv[1];
+	
+	/* A session can be recorded to, or replayed from, a log */
+	if(argc == 6 && strcmp(argv[1],"-record") == 0){
+		args = &argv[3];
+		if(replayRecordStart(argv[2], args) != 0){
+			fprintf(stderr, "cannot record to %s\n", argv[2]);
+			exit(1);
+		}
+	}else if(argc == 3 && strcmp(argv[1],"-replay") == 0){
+		if(replayPlayStart(argv[2], args) != 0){
+			fprintf(stderr, "cannot replay %s\n", argv[2]);
+			exit(1);
+		}
+	}else if(argc == 6 && strcmp(argv[1],"-serve") == 0){
+		args = &argv[3];
+	}else if(argc != 4){
+		/* User must provide three commandline arguments for main and secondary memory. */ 
+		fprintf(stderr, "Usage: %s [-record log] mainMemorySize secondaryMemorySize pageSize\n", argv[0]);
+		fprintf(stderr, "       %s -replay log\n", argv[0]);
+		fprintf(stderr, "       %s -serve socket mainMemorySize secondaryMemorySize pageSize\n", argv[0]);
 		exit(1);
 	}
 	
 	/* Variables for the commandline arguments */
-	int main = atoi(argv[1]);
-	int secondary = atoi(argv[2]);
-	pageSize = atoi(argv[3]);
+	int main = atoi(args[0]);
+	int secondary = atoi(args[1]);
+	pageSize = atoi(args[2]);
 	
 	/* Creation of main/secondary memory based on commandline args */
 	createMainMem(main);
@@ -350,7 +1107,11 @@ int main(int argc, char* argv[]){
 	/* Initializes the Kernel, Process Table, VMM, and PID */
 	initialize();
 	
-	/* Starts user input (AKA: command prompt) */
+	/* Serves jobs on a socket, or starts user input (AKA: command prompt) */
+	if(strcmp(argv[1],"-serve") == 0){
+		serve(argv[2]);
+		return 0;
+	}
 	getCommand();
 	
 	/* Debugging Purposes ONLY *******************************
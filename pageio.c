@@ -0,0 +1,105 @@
+/*
+ * pageio.c
+ * asynchronous page copies between main and secondary memory for fos os
+ * Joshua Castelli/Nathan Helmig
+ */
+
+#include "pageio.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+struct PageioJob {
+	long *wbDst;
+	long *wbSrc;
+	long *dst;
+	long *src;
+	int words;
+	int done;
+	PageioJob *next;
+};
+
+static pthread_mutex_t ioLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t ioQueued = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t ioDone = PTHREAD_COND_INITIALIZER;
+static PageioJob *ioHead = NULL;
+static PageioJob *ioTail = NULL;
+static int ioRunning = 0;
+static pthread_t ioThread;
+
+/*================================================================================*/
+/*
+ * pageioWorker
+ *    run jobs in order, forever
+ */
+static void* pageioWorker(void *arg){
+	(void)arg;
+	pthread_mutex_lock(&ioLock);
+	for(;;){
+		while(ioHead == NULL){
+			pthread_cond_wait(&ioQueued, &ioLock);
+		}
+		PageioJob *job = ioHead;
+		ioHead = job->next;
+		if(ioHead == NULL) ioTail = NULL;
+		pthread_mutex_unlock(&ioLock);
+
+		if(job->wbDst != NULL) memcpy(job->wbDst, job->wbSrc, job->words * sizeof(long));
+		memcpy(job->dst, job->src, job->words * sizeof(long));
+
+		pthread_mutex_lock(&ioLock);
+		job->done = 1;
+		pthread_cond_broadcast(&ioDone);
+	}
+	return NULL;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * pageioSubmit
+ */
+PageioJob* pageioSubmit(long *wbDst, long *wbSrc, long *dst, long *src, int words){
+	PageioJob *job = malloc(sizeof(PageioJob));
+	if(job == NULL) return NULL;
+	job->wbDst = wbDst;
+	job->wbSrc = wbSrc;
+	job->dst = dst;
+	job->src = src;
+	job->words = words;
+	job->done = 0;
+	job->next = NULL;
+
+	pthread_mutex_lock(&ioLock);
+	if(!ioRunning){
+		if(pthread_create(&ioThread, NULL, pageioWorker, NULL) != 0){
+			pthread_mutex_unlock(&ioLock);
+			free(job);
+			return NULL;
+		}
+		pthread_detach(ioThread);
+		ioRunning = 1;
+	}
+	if(ioTail == NULL) ioHead = job;
+	else ioTail->next = job;
+	ioTail = job;
+	pthread_cond_signal(&ioQueued);
+	pthread_mutex_unlock(&ioLock);
+	return job;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * pageioWait
+ */
+void pageioWait(PageioJob *job){
+	pthread_mutex_lock(&ioLock);
+	while(!job->done){
+		pthread_cond_wait(&ioDone, &ioLock);
+	}
+	pthread_mutex_unlock(&ioLock);
+	free(job);
+}
+/*================================================================================*/
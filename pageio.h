@@ -0,0 +1,36 @@
+/*
+ * pageio.h
+ * asynchronous page copies between main and secondary memory for fos os
+ * Joshua Castelli/Nathan Helmig
+ *
+ * one I/O worker thread runs the jobs in the order they are submitted,
+ * so a page written back by one job is on secondary memory before any
+ * later job reads it again. a job may write a victim page back and then
+ * read the new page into the same frame
+ *
+ * like trace.c, pageio.c must not include computer2.h (pthread.h
+ * pulls in time.h), so memory is passed as long (WORD) pointers
+ */
+
+#ifndef PAGEIO_H
+#define PAGEIO_H
+
+typedef struct PageioJob PageioJob;
+
+/*
+ * pageioSubmit
+ *    queue a job: copy words from wbSrc to wbDst (skipped if wbDst is
+ *    NULL), then from src to dst. the worker is started on first use
+ *
+ *    return
+ *       the job, NULL on failure (nothing was queued)
+ */
+PageioJob* pageioSubmit(long *wbDst, long *wbSrc, long *dst, long *src, int words);
+
+/*
+ * pageioWait
+ *    block until job is done, then release it
+ */
+void pageioWait(PageioJob *job);
+
+#endif
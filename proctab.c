@@ -0,0 +1,328 @@
+/*
+ * proctab.c
+ * growable process table for fos os
+ * Joshua Castelli/Nathan Helmig
+ */
+
+#include "proctab.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+static ProcEntry **procChunks = NULL;   // PROC_CHUNK entries each
+static int nProcChunks = 0;
+static int freeSlot = -1;               // head of the free list
+static int nProcs = 0;
+
+/* pid -> slot, open addressing with linear probing; pid 0 is empty */
+static int *hashPid = NULL;
+static int *hashSlot = NULL;
+static int hashCap = 0;
+
+static ProcEntry *lastProc = NULL;
+
+#define PROC_ENTRY(slot) (&procChunks[(slot) / PROC_CHUNK][(slot) % PROC_CHUNK])
+
+/*================================================================================*/
+/*
+ * procHashFind
+ *    return the hash index holding pid, or the empty index where it would go
+ */
+static int procHashFind(int pid){
+	int i = (unsigned)pid * 2654435761u & (hashCap - 1);
+	while(hashPid[i] != 0 && hashPid[i] != pid){
+		i = (i + 1) & (hashCap - 1);
+	}
+	return i;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * procHashGrow
+ *    double the hash and rehash every pid
+ */
+static int procHashGrow(){
+	int *oldPid = hashPid;
+	int *oldSlot = hashSlot;
+	int oldCap = hashCap;
+
+	hashCap = oldCap ? oldCap * 2 : 2 * PROC_CHUNK;
+	hashPid = calloc(hashCap, sizeof(int));
+	hashSlot = calloc(hashCap, sizeof(int));
+	if(hashPid == NULL || hashSlot == NULL){
+		fprintf(stderr, "PROC: out of memory\n");
+		exit(1);
+	}
+	for(int i = 0; i < oldCap; i++){
+		if(oldPid[i] != 0){
+			int j = procHashFind(oldPid[i]);
+			hashPid[j] = oldPid[i];
+			hashSlot[j] = oldSlot[i];
+		}
+	}
+	free(oldPid);
+	free(oldSlot);
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * procHashRemove
+ *    remove pid, shifting later entries of its probe run back
+ */
+static void procHashRemove(int pid){
+	int i = procHashFind(pid);
+	if(hashPid[i] == 0) return;
+	hashPid[i] = 0;
+	for(int j = (i + 1) & (hashCap - 1); hashPid[j] != 0; j = (j + 1) & (hashCap - 1)){
+		int home = (unsigned)hashPid[j] * 2654435761u & (hashCap - 1);
+		/* move j into the hole at i unless its home lies in (i, j] */
+		if((j > i && (home <= i || home > j)) || (j < i && home <= i && home > j)){
+			hashPid[i] = hashPid[j];
+			hashSlot[i] = hashSlot[j];
+			hashPid[j] = 0;
+			i = j;
+		}
+	}
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * procTableInit
+ */
+int procTableInit(){
+	for(int c = 0; c < nProcChunks; c++){
+		for(int i = 0; i < PROC_CHUNK; i++){
+			free(procChunks[c][i].secPages);
+		}
+		free(procChunks[c]);
+	}
+	free(procChunks);
+	free(hashPid);
+	free(hashSlot);
+	procChunks = NULL;
+	nProcChunks = 0;
+	freeSlot = -1;
+	nProcs = 0;
+	hashPid = NULL;
+	hashSlot = NULL;
+	hashCap = 0;
+	lastProc = NULL;
+	return procHashGrow();
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * procTableAlloc
+ *    adds a chunk of entries when the free list is empty
+ */
+Process* procTableAlloc(){
+	if(freeSlot == -1){
+		ProcEntry **chunks = realloc(procChunks, (nProcChunks + 1) * sizeof(ProcEntry*));
+		if(chunks == NULL) return NULL;
+		procChunks = chunks;
+		ProcEntry *chunk = calloc(PROC_CHUNK, sizeof(ProcEntry));
+		if(chunk == NULL) return NULL;
+		procChunks[nProcChunks] = chunk;
+		for(int i = PROC_CHUNK - 1; i >= 0; i--){
+			chunk[i].slot = nProcChunks * PROC_CHUNK + i;
+			chunk[i].nextFree = freeSlot;
+			freeSlot = chunk[i].slot;
+		}
+		nProcChunks++;
+	}
+
+	ProcEntry *entry = PROC_ENTRY(freeSlot);
+	freeSlot = entry->nextFree;
+	entry->nextFree = -1;
+	entry->nPages = 0;
+	entry->resident = 0;
+	entry->dirty = 0;
+	entry->slices = 0;
+	entry->pagedIn = FALSE;
+	entry->verified = FALSE;
+	entry->group = NULL;
+	entry->tid = 0;
+	entry->costRec = -1;
+	entry->cacheRec = -1;
+	initProcessTable(&entry->proc, 1);
+	return &entry->proc;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * procTableAdd
+ */
+int procTableAdd(Process *process, int pid){
+	if(pid <= 0 || procTableFind(pid) != NULL) return -1;
+	if(2 * (nProcs + 1) > hashCap) procHashGrow();
+
+	int i = procHashFind(pid);
+	hashPid[i] = pid;
+	hashSlot[i] = ((ProcEntry*)process)->slot;
+	process->pid = pid;
+	nProcs++;
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * procTableFree
+ */
+void procTableFree(Process *process){
+	ProcEntry *entry = (ProcEntry*)process;
+
+	if(process->pid > 0 && procTableFind(process->pid) == process){
+		procHashRemove(process->pid);
+		nProcs--;
+	}
+	if(lastProc == entry) lastProc = NULL;
+	process->valid = FALSE;
+	process->pid = 0;
+	entry->nPages = 0;
+	entry->nextFree = freeSlot;
+	freeSlot = entry->slot;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * procTableFind
+ *    the last entry found is remembered, the vmm asks for the
+ *    running process on every access
+ */
+Process* procTableFind(int pid){
+	if(lastProc != NULL && lastProc->proc.pid == pid) return &lastProc->proc;
+	if(pid <= 0 || hashCap == 0) return NULL;
+
+	int i = procHashFind(pid);
+	if(hashPid[i] == 0) return NULL;
+	lastProc = PROC_ENTRY(hashSlot[i]);
+	return &lastProc->proc;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * procTableNext
+ */
+Process* procTableNext(int *slot){
+	while(*slot < nProcChunks * PROC_CHUNK){
+		ProcEntry *entry = PROC_ENTRY(*slot);
+		(*slot)++;
+		if(entry->proc.pid > 0 && procTableFind(entry->proc.pid) == &entry->proc){
+			return &entry->proc;
+		}
+	}
+	return NULL;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * procTableCount
+ */
+int procTableCount(){
+	return nProcs;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * procTableAddPage
+ */
+int procTableAddPage(int pid, int sPage){
+	ProcEntry *entry = (ProcEntry*)procTableFind(pid);
+	if(entry == NULL) return -1;
+
+	if(entry->nPages == entry->capPages){
+		int cap = entry->capPages ? entry->capPages * 2 : 8;
+		int *pages = realloc(entry->secPages, cap * sizeof(int));
+		if(pages == NULL) return -1;
+		entry->secPages = pages;
+		entry->capPages = cap;
+	}
+	entry->secPages[entry->nPages] = sPage;
+	return entry->nPages++;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * procTableSetPage
+ */
+int procTableSetPage(int pid, int vPage, int sPage){
+	ProcEntry *entry = (ProcEntry*)procTableFind(pid);
+	if(entry == NULL || vPage < 0 || vPage >= entry->nPages) return -1;
+	entry->secPages[vPage] = sPage;
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * procTablePages
+ */
+int procTablePages(int pid, int **secPages){
+	ProcEntry *entry = (ProcEntry*)procTableFind(pid);
+	if(entry == NULL) return -1;
+	*secPages = entry->secPages;
+	return entry->nPages;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * procTableClearPages
+ */
+void procTableClearPages(int pid){
+	ProcEntry *entry = (ProcEntry*)procTableFind(pid);
+	if(entry == NULL) return;
+	entry->nPages = 0;
+	entry->resident = 0;
+	entry->dirty = 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * procTableCountPages
+ */
+void procTableCountPages(int pid, int resident, int dirty){
+	ProcEntry *entry = (ProcEntry*)procTableFind(pid);
+	if(entry == NULL) return;
+	entry->resident += resident;
+	entry->dirty += dirty;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * procTablePageCounts
+ */
+int procTablePageCounts(int pid, int *resident, int *dirty){
+	ProcEntry *entry = (ProcEntry*)procTableFind(pid);
+	if(entry == NULL) return -1;
+	*resident = entry->resident;
+	*dirty = entry->dirty;
+	return entry->nPages;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * procTableResetCounts
+ */
+void procTableResetCounts(){
+	for(int slot = 0; slot < nProcChunks * PROC_CHUNK; slot++){
+		PROC_ENTRY(slot)->resident = 0;
+		PROC_ENTRY(slot)->dirty = 0;
+	}
+}
+/*================================================================================*/
@@ -0,0 +1,182 @@
+/*
+ * proctab.h
+ * growable process table for fos os
+ * Joshua Castelli/Nathan Helmig
+ *
+ * entries are allocated in chunks of PROC_CHUNK and never move, so a
+ * Process* stays good until the entry is freed. free entries are kept
+ * on a free list and registered entries are found through a pid hash,
+ * so allocating, finding and freeing an entry are all O(1)
+ *
+ * every entry also keeps the secondary page frame of each virtual page
+ * of its process (maintained by the vmm), so translating and tearing
+ * down a process never scans the whole page table
+ */
+
+#ifndef PROCTAB_H
+#define PROCTAB_H
+
+#include "computer2.h"
+#include "fos-kernel2.h"
+
+#define PROC_CHUNK 64
+
+struct ThreadGroup;
+
+/*
+ * ProcEntry - one slot of the process table
+ *    proc       the kernel's process table entry (must be first)
+ *    slot       index of the entry in the table
+ *    nextFree   next slot on the free list, -1 at the end
+ *    nPages     number of virtual pages recorded in secPages
+ *    secPages   secondary page frame of each virtual page
+ *    resident   its pages in main memory, dirty how many of them are
+ *               dirty (kept up to date by the vmm, see VmmCounts)
+ *    slices     length of its next quantum with the adaptive quantum
+ *               (kept by the scheduler), 0 until it first runs
+ *    pagedIn    a page-in it waited for has landed since it last ran
+ *               (kept by the scheduler)
+ *    verified   its code passed fexVerify when it was loaded (shown by ps;
+ *               its run is checked all the same, see fex.h)
+ *    group      the threads of its process (thread.c), NULL while the
+ *               process has started none
+ *    tid        its thread id within the process, 0 for the thread the
+ *               process was loaded as (the one registered under pid)
+ *    costRec, cacheRec
+ *               index of its record in cost.c and cache.c, -1 until
+ *               the module has looked it up (the records of all its
+ *               threads are under its pid)
+ */
+typedef struct {
+	Process proc;
+	int slot;
+	int nextFree;
+	int nPages;
+	int capPages;
+	int *secPages;
+	int resident;
+	int dirty;
+	int slices;
+	int pagedIn;
+	int verified;
+	struct ThreadGroup *group;
+	int tid;
+	int costRec;
+	int cacheRec;
+} ProcEntry;
+
+/*
+ * procTableInit
+ *    make an empty process table, dropping any old one
+ *
+ *    return
+ *       0 success
+ *       -1 out of memory
+ */
+int procTableInit();
+
+/*
+ * procTableAlloc
+ *    take a free entry (set up by the kernel's initProcessTable)
+ *    the entry cannot be found by pid until procTableAdd
+ *
+ *    return
+ *       the entry, NULL if out of memory
+ */
+Process* procTableAlloc();
+
+/*
+ * procTableAdd
+ *    register an allocated entry under pid (sets process->pid)
+ *
+ *    return
+ *       0 success
+ *       -1 failure (pid is already registered)
+ */
+int procTableAdd(Process *process, int pid);
+
+/*
+ * procTableFree
+ *    unregister the entry and put it back on the free list
+ *    the vmm must already have released its pages (pageTableProcessTerm)
+ */
+void procTableFree(Process *process);
+
+/*
+ * procTableFind
+ *    return the entry registered under pid, NULL if there is none
+ */
+Process* procTableFind(int pid);
+
+/*
+ * procTableNext
+ *    iterate over registered entries in slot order
+ *    start with *slot = 0; returns NULL when there are no more
+ */
+Process* procTableNext(int *slot);
+
+/*
+ * procTableCount
+ *    return the number of registered entries
+ */
+int procTableCount();
+
+/*
+ * procTableAddPage
+ *    record sPage as the next virtual page of process pid
+ *
+ *    return
+ *       the virtual page number
+ *       -1 failure (no such pid, out of memory)
+ */
+int procTableAddPage(int pid, int sPage);
+
+/*
+ * procTableSetPage
+ *    record sPage as virtual page vPage of process pid
+ *
+ *    return
+ *       0 success
+ *       -1 failure (no such pid or page)
+ */
+int procTableSetPage(int pid, int vPage, int sPage);
+
+/*
+ * procTablePages
+ *    the virtual to secondary page map of pid
+ *
+ *    return
+ *       the number of pages (*secPages set), -1 if there is no such pid
+ */
+int procTablePages(int pid, int **secPages);
+
+/*
+ * procTableClearPages
+ *    forget every page of pid
+ */
+void procTableClearPages(int pid);
+
+/*
+ * procTableCountPages
+ *    add resident and dirty (either may be negative) to the page counts
+ *    of pid; pages of no process (pid 0) are not counted
+ */
+void procTableCountPages(int pid, int resident, int dirty);
+
+/*
+ * procTablePageCounts
+ *    the page counts of pid
+ *
+ *    return
+ *       the number of virtual pages (*resident, *dirty set), -1 if there
+ *       is no such pid
+ */
+int procTablePageCounts(int pid, int *resident, int *dirty);
+
+/*
+ * procTableResetCounts
+ *    zero the page counts of every entry (before the vmm recounts)
+ */
+void procTableResetCounts();
+
+#endif
@@ -0,0 +1,297 @@
+/*
+ * prof.c
+ * per-PC guest execution profiler for fos os
+ * Joshua Castelli/Nathan Helmig
+ */
+
+#include "prof.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * ProfLoop - a backward branch from the instruction at 'from' to 'target'
+ * ProfStack - one distinct GOSU chain and how many instructions ran in it
+ */
+typedef struct {
+	WORD from;
+	WORD target;
+	long taken;
+} ProfLoop;
+
+typedef struct {
+	int depth;
+	WORD frame[PROF_MAX_DEPTH];
+	long count;
+} ProfStack;
+
+typedef struct {
+	int pid;
+	WORD size;          // length of exec/faults/text arrays
+	long *exec;
+	long *faults;
+	char (*text)[5];    // instruction at each PC, for the report
+	long total;         // instructions seen
+	WORD instPc;        // PC of the instruction currently running
+	char pendingOp;     // opcode still waiting for its address word
+	WORD branchTarget;  // backward target of the last BRAN/BRNN, -1 if none
+	int branchLoop;     // index into loops of that branch
+	WORD callStack[PROF_MAX_DEPTH];
+	int depth;
+	int curStack;       // index into stacks of callStack
+	ProfLoop *loops;
+	int nLoops, capLoops;
+	ProfStack *stacks;
+	int nStacks, capStacks;
+} ProfRec;
+
+int profEnabled = FALSE;
+
+static ProfRec **profRecs = NULL;
+static int nProfRecs = 0;
+static ProfRec *lastRec = NULL;
+
+/*================================================================================*/
+/*
+ * toggleProfiler
+ *    return: 1 if profiler is on, 0 if off
+ */
+int toggleProfiler(){
+	profEnabled = !profEnabled;
+	if(profEnabled) printf("PROF: profiler on\n");
+	return profEnabled;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * profFindStack
+ *    index of the stacks entry matching the current call stack, added if new
+ */
+static int profFindStack(ProfRec *r){
+	for(int i = 0; i < r->nStacks; i++){
+		if(r->stacks[i].depth == r->depth
+		   && memcmp(r->stacks[i].frame, r->callStack, r->depth * sizeof(WORD)) == 0){
+			return i;
+		}
+	}
+	if(r->nStacks == r->capStacks){
+		r->capStacks = r->capStacks ? r->capStacks * 2 : 8;
+		r->stacks = realloc(r->stacks, r->capStacks * sizeof(ProfStack));
+	}
+	ProfStack *s = &r->stacks[r->nStacks];
+	s->depth = r->depth;
+	memcpy(s->frame, r->callStack, r->depth * sizeof(WORD));
+	s->count = 0;
+	return r->nStacks++;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * profGetRec
+ *    the profile record of pid, created on first use
+ */
+static ProfRec* profGetRec(int pid){
+	if(lastRec != NULL && lastRec->pid == pid) return lastRec;
+	for(int i = 0; i < nProfRecs; i++){
+		if(profRecs[i]->pid == pid){
+			lastRec = profRecs[i];
+			return lastRec;
+		}
+	}
+	ProfRec *r = calloc(1, sizeof(ProfRec));
+	if(r == NULL) return NULL;
+	r->pid = pid;
+	r->branchTarget = -1;
+	r->curStack = profFindStack(r);
+	profRecs = realloc(profRecs, (nProfRecs + 1) * sizeof(ProfRec*));
+	profRecs[nProfRecs++] = r;
+	lastRec = r;
+	return r;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * profGrow
+ *    make sure the per-PC arrays of r cover pc
+ */
+static int profGrow(ProfRec *r, WORD pc){
+	if(pc < r->size) return 0;
+	WORD size = r->size ? r->size : 64;
+	while(size <= pc) size *= 2;
+	r->exec = realloc(r->exec, size * sizeof(long));
+	r->faults = realloc(r->faults, size * sizeof(long));
+	r->text = realloc(r->text, size * sizeof(*r->text));
+	if(r->exec == NULL || r->faults == NULL || r->text == NULL){
+		fprintf(stderr, "PROF: out of memory\n");
+		exit(1);
+	}
+	memset(r->exec + r->size, 0, (size - r->size) * sizeof(long));
+	memset(r->faults + r->size, 0, (size - r->size) * sizeof(long));
+	memset(r->text + r->size, 0, (size - r->size) * sizeof(*r->text));
+	r->size = size;
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * profAddLoop
+ *    index of the loop entry for the edge from -> target, added if new
+ */
+static int profAddLoop(ProfRec *r, WORD from, WORD target){
+	for(int i = 0; i < r->nLoops; i++){
+		if(r->loops[i].from == from && r->loops[i].target == target) return i;
+	}
+	if(r->nLoops == r->capLoops){
+		r->capLoops = r->capLoops ? r->capLoops * 2 : 8;
+		r->loops = realloc(r->loops, r->capLoops * sizeof(ProfLoop));
+	}
+	r->loops[r->nLoops].from = from;
+	r->loops[r->nLoops].target = target;
+	r->loops[r->nLoops].taken = 0;
+	return r->nLoops++;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * profNoteRead
+ *    classify a read as instruction fetch, address word, or data
+ */
+void profNoteRead(int pid, WORD vAddr, WORD pc, WORD word){
+	if(vAddr != pc || vAddr < 0) return;
+
+	ProfRec *r = profGetRec(pid);
+	if(r == NULL) return;
+
+	/* the address word of the instruction at instPc */
+	if(r->pendingOp != 0){
+		char op = r->pendingOp;
+		r->pendingOp = 0;
+		if((op == BRAN || op == BRNN) && word <= r->instPc){
+			r->branchTarget = word;
+			r->branchLoop = profAddLoop(r, r->instPc, word);
+		}else if(op == GOSU && r->depth < PROF_MAX_DEPTH){
+			r->callStack[r->depth++] = word;
+			r->curStack = profFindStack(r);
+		}
+		return;
+	}
+
+	/* an instruction fetch */
+	INST_REG inst;
+	inst.w = word;
+	char op = inst.s[0];
+
+	if(r->branchTarget != -1){
+		if(vAddr == r->branchTarget) r->loops[r->branchLoop].taken++;
+		r->branchTarget = -1;
+	}
+
+	profGrow(r, vAddr);
+	r->instPc = vAddr;
+	r->exec[vAddr]++;
+	r->total++;
+	if(r->text[vAddr][0] == 0) memcpy(r->text[vAddr], inst.s, 4);
+	r->stacks[r->curStack].count++;
+
+	if(HAS_ADDR_WORD(op)){
+		r->pendingOp = op;
+	}else if(op == RETU && r->depth > 0){
+		r->depth--;
+		r->curStack = profFindStack(r);
+	}
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * profNoteFault
+ *    charge a page fault to the instruction that caused it
+ *    a fault on the fetch itself belongs to the instruction being fetched
+ */
+void profNoteFault(int pid, WORD vAddr, WORD pc){
+	ProfRec *r = profGetRec(pid);
+	if(r == NULL) return;
+
+	WORD at = (vAddr == pc && r->pendingOp == 0) ? vAddr : r->instPc;
+	if(at < 0) return;
+	profGrow(r, at);
+	r->faults[at]++;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * profReport
+ *    top-N PCs, loops and folded stacks for pid
+ */
+static long *sortExec;
+
+static int profCompare(const void *a, const void *b){
+	long ea = sortExec[*(const WORD*)a];
+	long eb = sortExec[*(const WORD*)b];
+	if(ea != eb) return ea < eb ? 1 : -1;
+	return (*(const WORD*)a > *(const WORD*)b) - (*(const WORD*)a < *(const WORD*)b);
+}
+
+int profReport(int pid, int topN){
+	ProfRec *r = NULL;
+	for(int i = 0; i < nProfRecs; i++){
+		if(profRecs[i]->pid == pid) r = profRecs[i];
+	}
+	if(r == NULL || r->total == 0){
+		printf("no profile recorded for PID %d\n", pid);
+		return -1;
+	}
+
+	/* top-N PCs by execution count */
+	WORD *order = malloc(r->size * sizeof(WORD));
+	int n = 0;
+	for(WORD pc = 0; pc < r->size; pc++){
+		if(r->exec[pc] > 0 || r->faults[pc] > 0) order[n++] = pc;
+	}
+	sortExec = r->exec;
+	qsort(order, n, sizeof(WORD), profCompare);
+
+	printf("=================Profile PID %d=================\n", pid);
+	printf("instructions: %ld\n", r->total);
+	printf("PC\tInst\tExec\t%%\tFaults\n");
+	for(int i = 0; i < n && i < topN; i++){
+		WORD pc = order[i];
+		printf("%ld\t%.4s\t%ld\t%.1f\t%ld\n", pc, r->text[pc], r->exec[pc],
+		       100.0 * r->exec[pc] / r->total, r->faults[pc]);
+	}
+	free(order);
+
+	/* loops: the body is everything from target up to the branch */
+	printf("---loops---\n");
+	if(r->nLoops == 0) printf("   (NO LOOPS)\n");
+	for(int i = 0; i < r->nLoops; i++){
+		ProfLoop *l = &r->loops[i];
+		long body = 0;
+		for(WORD pc = l->target; pc <= l->from && pc < r->size; pc++){
+			body += r->exec[pc];
+		}
+		printf("%ld..%ld\ttaken %ld\tbody %ld (%.1f%%)\n", l->target, l->from,
+		       l->taken, body, 100.0 * body / r->total);
+	}
+
+	/* folded stacks for flamegraph.pl */
+	printf("---folded stacks---\n");
+	for(int i = 0; i < r->nStacks; i++){
+		ProfStack *s = &r->stacks[i];
+		if(s->count == 0) continue;
+		printf("pid%d", pid);
+		for(int d = 0; d < s->depth; d++){
+			printf(";sub_%ld", s->frame[d]);
+		}
+		printf(" %ld\n", s->count);
+	}
+	printf("================================================\n");
+	return 0;
+}
+/*================================================================================*/
@@ -0,0 +1,63 @@
+/*
+ * prof.h
+ * per-PC guest execution profiler for fos os
+ * Joshua Castelli/Nathan Helmig
+ */
+
+#ifndef PROF_H
+#define PROF_H
+
+#include "computer2.h"
+
+/*
+ * the profiler watches every read the cpu makes through the vmm
+ *    a read at vAddr == cpu.pc is an instruction fetch (or the address
+ *    word that follows one, see HAS_ADDR_WORD in frisc2.h)
+ *    every other read/write is a data access and is ignored
+ *
+ * for each pid it keeps
+ *    exec count per PC       - how many times the instruction at PC ran
+ *    fault count per PC      - page faults taken while running PC
+ *    loops                   - backward BRAN/BRNN edges and times taken
+ *    folded call stacks      - GOSU/RETU chains, one sample per instruction
+ */
+
+#define PROF_TOP_N 10
+#define PROF_MAX_DEPTH 32
+
+extern int profEnabled;
+
+/*
+ * toggleProfiler
+ *    turn the profiler on (or off); collected data is kept either way
+ *    return: 1 if profiler is on, 0 if off
+ */
+int toggleProfiler();
+
+/*
+ * profNoteRead
+ *    called by the vmm after each successful read
+ *    pid - process making the read, vAddr - virtual address read
+ *    pc - cpu.pc at the time of the read, word - the value read
+ */
+void profNoteRead(int pid, WORD vAddr, WORD pc, WORD word);
+
+/*
+ * profNoteFault
+ *    called by the vmm when a read/write of vAddr page faults
+ */
+void profNoteFault(int pid, WORD vAddr, WORD pc);
+
+/*
+ * profReport
+ *    print the top-N PCs, detected loops and folded stacks of pid
+ *    the folded stack lines ("frame;frame;frame count") can be fed
+ *    directly to flamegraph.pl
+ *
+ *    return
+ *       0 success
+ *       -1 no profile recorded for pid
+ */
+int profReport(int pid, int topN);
+
+#endif
@@ -0,0 +1,392 @@
+/*
+ * replay.c
+ * deterministic record/replay of fos os sessions
+ * Joshua Castelli/Nathan Helmig
+ */
+
+#define _GNU_SOURCE
+#include "replay.h"
+#include "hrtime.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#define REPLAY_MAX_PHASES 64
+
+/*
+ * ReplayCheck - one checkpoint of a recorded session
+ *    type 'C' (prompt): a = clock, b = page table sum, c = output hash, d = output bytes
+ *    type 'Q' (quantum): a = pid, b = clock
+ */
+typedef struct {
+	char type;
+	long a;
+	unsigned long b;
+	unsigned long long c;
+	long long d;
+} ReplayCheck;
+
+/*
+ * ReplayFileRec - a program file of a recorded session
+ */
+typedef struct {
+	char *name;
+	char *path;
+} ReplayFileRec;
+
+/*
+ * ReplayPhase - host time spent in one kind of command
+ */
+typedef struct {
+	char name[32];
+	long count;
+	long long ns;
+} ReplayPhase;
+
+int replayMode = REPLAY_OFF;
+
+static FILE *replayLog = NULL;
+static char replayArgs[3][64];
+
+/* everything written to stdout is hashed (FNV-1a) and counted */
+static unsigned long long outHash = 14695981039346656037ull;
+static long long outBytes = 0;
+
+/* replay only */
+static char replayDir[64];
+static ReplayCheck *checks = NULL;
+static int nChecks = 0;
+static int nextCheck = 0;
+static int diverged = -1;
+static ReplayFileRec *files = NULL;
+static int nFiles = 0;
+static int nextFile = 0;
+
+static ReplayPhase phases[REPLAY_MAX_PHASES];
+static int nPhases = 0;
+static int curPhase = -1;
+static long long phaseStart = 0;
+
+/*================================================================================*/
+/*
+ * replayOutWrite - stdout: hash, then pass to the real stdout
+ */
+static ssize_t replayOutWrite(void *cookie, const char *buf, size_t size){
+	(void)cookie;
+	for(size_t i = 0; i < size; i++){
+		outHash = (outHash ^ (unsigned char)buf[i]) * 1099511628211ull;
+	}
+	outBytes += size;
+	for(size_t done = 0; done < size; ){
+		ssize_t n = write(STDOUT_FILENO, buf + done, size - done);
+		if(n <= 0) return done > 0 ? (ssize_t)done : -1;
+		done += n;
+	}
+	return size;
+}
+
+/*
+ * replayInRead - stdin while recording: log what is read
+ */
+static ssize_t replayInRead(void *cookie, char *buf, size_t size){
+	(void)cookie;
+	ssize_t n = read(STDIN_FILENO, buf, size);
+	if(n > 0){
+		fprintf(replayLog, "I %ld\n", (long)n);
+		fwrite(buf, 1, n, replayLog);
+		fflush(replayLog);
+	}
+	return n;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * replayHashStdout
+ *    send stdout through replayOutWrite
+ */
+static int replayHashStdout(){
+	cookie_io_functions_t io = {NULL, replayOutWrite, NULL, NULL};
+	fflush(stdout);
+	FILE *out = fopencookie(NULL, "w", io);
+	if(out == NULL) return -1;
+	setvbuf(out, NULL, _IOLBF, BUFSIZ);
+	stdout = out;
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * replayCopy
+ *    copy len bytes from in to out (out may be NULL to skip them)
+ *    return: 0 success, -1 short read
+ */
+static int replayCopy(FILE *in, FILE *out, long len){
+	char buf[4096];
+	while(len > 0){
+		size_t n = fread(buf, 1, len < (long)sizeof(buf) ? len : (long)sizeof(buf), in);
+		if(n == 0) return -1;
+		if(out != NULL) fwrite(buf, 1, n, out);
+		len -= n;
+	}
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * replayPhaseEnd
+ *    add the time since replayCommand to the current phase
+ */
+static void replayPhaseEnd(){
+	if(curPhase == -1) return;
+	phases[curPhase].ns += hrtimeNow() - phaseStart;
+	phases[curPhase].count++;
+	curPhase = -1;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * replayFinish - atexit
+ *    close the log, or report the replay and remove its files
+ */
+static void replayFinish(){
+	replayPhaseEnd();
+	fflush(stdout);
+	if(replayMode == REPLAY_RECORD){
+		fclose(replayLog);
+		return;
+	}
+
+	long long total = 0;
+	fprintf(stderr, "=========================Replay=========================\n");
+	if(diverged != -1){
+		fprintf(stderr, "DIVERGED at checkpoint %d of %d\n", diverged + 1, nChecks);
+	}else if(nextCheck != nChecks){
+		fprintf(stderr, "stopped after %d of %d checkpoints\n", nextCheck, nChecks);
+	}else{
+		fprintf(stderr, "all %d checkpoints matched (clock, page table, output)\n", nChecks);
+	}
+	fprintf(stderr, "Phase\t\tCount\tTotal(ms)\tAvg(us)\n");
+	for(int i = 0; i < nPhases; i++){
+		fprintf(stderr, "%-15s\t%ld\t%.3f\t\t%.3f\n", phases[i].name, phases[i].count,
+		        phases[i].ns / 1e6, phases[i].count ? phases[i].ns / 1e3 / phases[i].count : 0.0);
+		total += phases[i].ns;
+	}
+	fprintf(stderr, "total\t\t\t%.3f\n", total / 1e6);
+	fprintf(stderr, "========================================================\n");
+
+	for(int i = 0; i < nFiles; i++){
+		unlink(files[i].path);
+	}
+	char path[96];
+	snprintf(path, sizeof(path), "%s/input", replayDir);
+	unlink(path);
+	rmdir(replayDir);
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * replayRecordStart
+ */
+int replayRecordStart(char *logName, char *args[3]){
+	replayLog = fopen(logName, "wb");
+	if(replayLog == NULL) return -1;
+	fprintf(replayLog, "FOSREPLAY 1 %s %s %s\n", args[0], args[1], args[2]);
+
+	cookie_io_functions_t io = {replayInRead, NULL, NULL, NULL};
+	FILE *in = fopencookie(NULL, "r", io);
+	if(in == NULL || replayHashStdout() != 0) return -1;
+	stdin = in;
+
+	replayMode = REPLAY_RECORD;
+	atexit(replayFinish);
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * replayPlayStart
+ *    the log is read once: input and files are written to a temporary
+ *    directory, checkpoints are kept in memory
+ */
+int replayPlayStart(char *logName, char *args[3]){
+	char line[1200];
+	char name[1024];
+	char path[96];
+	long len;
+	int version = 0;
+
+	FILE *log = fopen(logName, "rb");
+	if(log == NULL) return -1;
+	if(fgets(line, sizeof(line), log) == NULL
+	   || sscanf(line, "FOSREPLAY %d %63s %63s %63s", &version, replayArgs[0], replayArgs[1], replayArgs[2]) != 4
+	   || version != 1){
+		fclose(log);
+		return -1;
+	}
+	strcpy(replayDir, "/tmp/fosreplayXXXXXX");
+	if(mkdtemp(replayDir) == NULL){
+		fclose(log);
+		return -1;
+	}
+	snprintf(path, sizeof(path), "%s/input", replayDir);
+	FILE *input = fopen(path, "wb");
+	if(input == NULL){
+		fclose(log);
+		return -1;
+	}
+
+	int bad = 0;
+	while(!bad && fgets(line, sizeof(line), log) != NULL){
+		if(line[0] == 'I' && sscanf(line, "I %ld", &len) == 1){
+			bad = replayCopy(log, input, len);
+		}else if(line[0] == 'F' && sscanf(line, "F %ld %1023[^\n]", &len, name) == 2){
+			files = realloc(files, (nFiles + 1) * sizeof(ReplayFileRec));
+			snprintf(path, sizeof(path), "%s/%s%d", replayDir, len < 0 ? "missing" : "f", nFiles);
+			files[nFiles].name = strdup(name);
+			files[nFiles].path = strdup(path);
+			if(len >= 0){
+				FILE *out = fopen(path, "wb");
+				bad = out == NULL || replayCopy(log, out, len);
+				if(out != NULL) fclose(out);
+			}
+			nFiles++;
+		}else if(line[0] == 'C' || line[0] == 'Q'){
+			ReplayCheck c = {line[0], 0, 0, 0, 0};
+			if(line[0] == 'C') sscanf(line, "C %ld %lu %llu %lld", &c.a, &c.b, &c.c, &c.d);
+			else sscanf(line, "Q %ld %lu", &c.a, &c.b);
+			checks = realloc(checks, (nChecks + 1) * sizeof(ReplayCheck));
+			checks[nChecks++] = c;
+		}else{
+			bad = 1;
+		}
+	}
+	fclose(log);
+	fclose(input);
+	if(bad){
+		fprintf(stderr, "REPLAY: %s is truncated or corrupt\n", logName);
+		return -1;
+	}
+
+	snprintf(path, sizeof(path), "%s/input", replayDir);
+	if(freopen(path, "r", stdin) == NULL || replayHashStdout() != 0) return -1;
+	for(int i = 0; i < 3; i++){
+		args[i] = replayArgs[i];
+	}
+
+	replayMode = REPLAY_PLAY;
+	atexit(replayFinish);
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * replayFile
+ */
+char* replayFile(char *fileName){
+	if(replayMode == REPLAY_RECORD){
+		long len;
+		FILE *fin = fopen(fileName, "rb");
+		if(fin == NULL){
+			fprintf(replayLog, "F -1 %s\n", fileName);
+			return fileName;
+		}
+		fseek(fin, 0, SEEK_END);
+		len = ftell(fin);
+		fseek(fin, 0, SEEK_SET);
+		fprintf(replayLog, "F %ld %s\n", len, fileName);
+		replayCopy(fin, replayLog, len);
+		fclose(fin);
+		fflush(replayLog);
+		return fileName;
+	}
+	if(replayMode == REPLAY_PLAY){
+		if(nextFile == nFiles || strcmp(files[nextFile].name, fileName) != 0){
+			fprintf(stderr, "REPLAY: %s was not loaded at this point of the recording\n", fileName);
+			return fileName;
+		}
+		return files[nextFile++].path;
+	}
+	return fileName;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * replayCheck
+ *    log c, or compare it with the next recorded checkpoint
+ */
+static void replayCheck(ReplayCheck c){
+	if(replayMode == REPLAY_RECORD){
+		if(c.type == 'C') fprintf(replayLog, "C %ld %lu %llu %lld\n", c.a, c.b, c.c, c.d);
+		else fprintf(replayLog, "Q %ld %lu\n", c.a, c.b);
+		return;
+	}
+	if(diverged != -1) return;
+	if(nextCheck == nChecks){
+		diverged = nextCheck;
+		fprintf(stderr, "REPLAY: session continued past the end of the recording\n");
+		return;
+	}
+	ReplayCheck *r = &checks[nextCheck];
+	if(r->type != c.type || r->a != c.a || r->b != c.b || r->c != c.c || r->d != c.d){
+		diverged = nextCheck;
+		if(c.type == 'C'){
+			fprintf(stderr, "REPLAY: diverged at checkpoint %d: clock %ld/%ld, page table %lu/%lu, output %lld/%lld bytes (recorded/now)\n",
+			        nextCheck + 1, r->a, c.a, r->b, c.b, r->d, c.d);
+		}else{
+			fprintf(stderr, "REPLAY: diverged at checkpoint %d: quantum of PID %ld/%ld at clock %lu/%lu (recorded/now)\n",
+			        nextCheck + 1, r->a, c.a, r->b, c.b);
+		}
+	}
+	nextCheck++;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * replayPrompt
+ */
+void replayPrompt(long clockNow, unsigned long pageTableSum){
+	replayPhaseEnd();
+	fflush(stdout);
+	ReplayCheck c = {'C', clockNow, pageTableSum, outHash, outBytes};
+	replayCheck(c);
+	if(replayMode == REPLAY_RECORD) fflush(replayLog);
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * replayCommand
+ */
+void replayCommand(char *command){
+	replayPhaseEnd();
+	for(curPhase = 0; curPhase < nPhases && strcmp(phases[curPhase].name, command) != 0; curPhase++);
+	if(curPhase == nPhases){
+		if(nPhases == REPLAY_MAX_PHASES){
+			curPhase = -1;
+			return;
+		}
+		snprintf(phases[nPhases++].name, sizeof(phases[0].name), "%s", command);
+	}
+	phaseStart = hrtimeNow();
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * replayQuantum
+ */
+void replayQuantum(int pid, long clockNow){
+	ReplayCheck c = {'Q', pid, clockNow, 0, 0};
+	replayCheck(c);
+}
+/*================================================================================*/
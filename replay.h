@@ -0,0 +1,87 @@
+/*
+ * replay.h
+ * deterministic record/replay of fos os sessions
+ * Joshua Castelli/Nathan Helmig
+ *
+ * recording logs everything a session depends on that is not in the
+ * binary: the memory sizes, every byte read from stdin and the contents
+ * of every program file loaded. replaying feeds the same input and files
+ * back, so the simulated machine must do exactly the same thing
+ *
+ * checkpoints are logged at every command prompt (clock, page table
+ * checksum, hash of everything written to stdout) and at every quantum
+ * boundary (pid, clock); replay compares them and reports the first one
+ * that differs. replay also times each command with the host clock
+ *
+ * a replay log is a sequence of records, each a text line that may be
+ * followed by raw bytes:
+ *    FOSREPLAY 1 <main> <sec> <page>
+ *    I <len>                      then len bytes of stdin
+ *    F <len> <name>               then len bytes of the file (-1: no file)
+ *    C <clock> <sum> <hash> <n>   checkpoint at a prompt
+ *    Q <pid> <clock>              checkpoint at a quantum boundary
+ *
+ * like trace.c this does not include computer2.h (it uses time.h)
+ */
+
+#ifndef REPLAY_H
+#define REPLAY_H
+
+#define REPLAY_OFF 0
+#define REPLAY_RECORD 1
+#define REPLAY_PLAY 2
+
+extern int replayMode;
+
+/*
+ * replayRecordStart
+ *    start recording to logName; args are the three memory arguments
+ *    stdin and stdout are replaced by streams that log/hash what passes
+ *
+ *    return
+ *       0 success
+ *       -1 failure (cannot create the log)
+ */
+int replayRecordStart(char *logName, char *args[3]);
+
+/*
+ * replayPlayStart
+ *    start replaying logName; stdin is replaced by the recorded input
+ *    and args is set to the recorded memory arguments
+ *
+ *    return
+ *       0 success
+ *       -1 failure (missing or bad log)
+ */
+int replayPlayStart(char *logName, char *args[3]);
+
+/*
+ * replayFile
+ *    call with the name of every program file before opening it
+ *
+ *    return
+ *       the name to open: fileName when recording (its contents are
+ *       logged), the recorded copy when replaying
+ */
+char* replayFile(char *fileName);
+
+/*
+ * replayPrompt
+ *    call before each command prompt; ends the timing of the last
+ *    command and logs (or checks) a checkpoint
+ */
+void replayPrompt(long clockNow, unsigned long pageTableSum);
+
+/*
+ * replayCommand
+ *    call with each command read; starts timing it
+ */
+void replayCommand(char *command);
+
+/*
+ * replayQuantum
+ *    call at every quantum boundary; logs (or checks) a checkpoint
+ */
+void replayQuantum(int pid, long clockNow);
+
+#endif
@@ -0,0 +1,661 @@
+/*
+ * scheduler.c
+ * process scheduling and asynchronous page faults for fos os
+ * Joshua Castelli/Nathan Helmig
+ */
+
+#include "scheduler.h"
+#include "vmm.h"
+#include "cost.h"
+#include "trace.h"
+#include "replay.h"
+#include "xinst.h"
+#include "proctab.h"
+#include "pageio.h"
+#include "tier.h"
+#include "console.h"
+#include "thread.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <setjmp.h>
+
+/*
+ * SchedIO - a page-in in flight
+ *    frame - the main page frame it fills (sPage is mapped to it when done)
+ *    doneAt - simulated cycle at which the device finishes it
+ *    waitFrom - simulated cycle at which the process blocked
+ */
+typedef struct {
+	PageioJob *job;
+	Process *process;
+	int sPage;
+	int frame;
+	int writeBack;
+	long doneAt;
+	long waitFrom;
+} SchedIO;
+
+int schedAsync = FALSE;
+SchedExitHook schedExitHook = NULL;
+
+SchedModel schedModel = {
+	0,      // adaptive (fixed)
+	1       // slices
+};
+
+static long dispatches = 0;
+static long slicesRun = 0;
+static long switches = 0;
+static long resumes = 0;
+static long switchCycles = 0;
+static CPU_STATE exitState;
+
+/* page-ins in flight, oldest first (the device serves them in order) */
+static SchedIO *ios = NULL;
+static int nIos = 0;
+static int capIos = 0;
+static long ioBusyUntil = 0;
+
+/*
+ * pages that have landed stay pinned for their process until it gets
+ * through a quantum, so an instruction that needs several pages is not
+ * robbed of one while it waits for the next
+ */
+typedef struct {
+	Process *process;
+	int sPage;
+} SchedHeld;
+
+static SchedHeld *held = NULL;
+static int nHeld = 0;
+static int capHeld = 0;
+
+/* ready queue (ring) */
+static Process **ready = NULL;
+static int readyHead = 0;
+static int nReady = 0;
+static int capReady = 0;
+
+/* where a process that has made a bad access is ended */
+static jmp_buf busJump;
+
+/* the running process's instruction start, for rolling back a fault */
+static jmp_buf faultJump;
+static Process *running = NULL;
+static FriscCPU instCpu;
+static long instClock;
+static int pendingAddr;
+static int pendingData;
+static int fetches;
+static int woken;
+
+/* the process whose registers are still in the cpu, not saved yet */
+static Process *live = NULL;
+
+/*================================================================================*/
+/*
+ * toggleAsyncIO
+ */
+int toggleAsyncIO(){
+	schedAsync = !schedAsync;
+	return schedAsync;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * schedSet
+ */
+int schedSet(char *name, int value){
+	if(strcmp(name, "adaptive") == 0){
+		if(value != 0 && value != 1) return -1;
+		schedModel.adaptive = value;
+	}else if(strcmp(name, "slices") == 0){
+		if(value < 1) return -1;
+		schedModel.slices = value;
+	}else{
+		return -1;
+	}
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * schedSaveLive
+ *    save the registers still in the cpu to their process
+ */
+static void schedSaveLive(){
+	if(live == NULL) return;
+	saveProcessState(live);
+	live = NULL;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * schedSlices
+ *    length of the next quantum of process (see SchedModel)
+ */
+static int schedSlices(Process *process){
+	ProcEntry *entry = (ProcEntry*)process;
+
+	if(!schedModel.adaptive) return schedModel.slices;
+	if(entry->slices == 0 || entry->slices > schedModel.slices) entry->slices = schedModel.slices;
+	int share = schedModel.slices / (nReady + 1);
+	if(share < 1) share = 1;
+	return entry->slices < share ? entry->slices : share;
+}
+
+/*
+ * schedAdapt
+ *    halve or double the quantum of process after one it did or did
+ *    not fault in
+ */
+static void schedAdapt(Process *process, int faulted){
+	ProcEntry *entry = (ProcEntry*)process;
+
+	if(!schedModel.adaptive) return;
+	if(faulted){
+		if(entry->slices > 1) entry->slices /= 2;
+	}else if(entry->slices < schedModel.slices){
+		entry->slices *= 2;
+		if(entry->slices > schedModel.slices) entry->slices = schedModel.slices;
+	}
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * schedEnqueue
+ *    add process to the back of the ready queue
+ */
+static void schedEnqueue(Process *process){
+	if(nReady == capReady){
+		int cap = capReady ? capReady * 2 : 64;
+		Process **grown = malloc(cap * sizeof(Process*));
+		if(grown == NULL){
+			fprintf(stderr, "SCHED: out of memory\n");
+			exit(1);
+		}
+		for(int i = 0; i < nReady; i++){
+			grown[i] = ready[(readyHead + i) % capReady];
+		}
+		free(ready);
+		ready = grown;
+		readyHead = 0;
+		capReady = cap;
+	}
+	ready[(readyHead + nReady++) % capReady] = process;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * schedDequeue
+ *    return: the process at the front of the ready queue, NULL if empty
+ */
+static Process* schedDequeue(){
+	if(nReady == 0) return NULL;
+	Process *process = ready[readyHead];
+	readyHead = (readyHead + 1) % capReady;
+	nReady--;
+	return process;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * schedWake
+ */
+void schedWake(Process *process){
+	process->state = PROCESS_READY;
+	schedEnqueue(process);
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * schedFinishIO
+ *    complete the oldest page-in: wait for the worker if it is behind
+ *    the simulated clock, map the page and make its process ready.
+ *    if the clock has not reached the page-in yet it is idled forward
+ */
+static void schedFinishIO(){
+	SchedIO io = ios[0];
+	for(int i = 1; i < nIos; i++){
+		ios[i - 1] = ios[i];
+	}
+	nIos--;
+
+	if(simCycles < io.doneAt) costChargeIdle(io.doneAt - simCycles);
+	pageioWait(io.job);
+	vmmPageInDone(io.sPage, io.frame);
+	if(nHeld == capHeld){
+		capHeld = capHeld ? capHeld * 2 : 64;
+		held = realloc(held, capHeld * sizeof(SchedHeld));
+		if(held == NULL){
+			fprintf(stderr, "SCHED: out of memory\n");
+			exit(1);
+		}
+	}
+	held[nHeld].process = io.process;
+	held[nHeld++].sPage = io.sPage;
+	costChargeWait(io.process->pid, io.doneAt - io.waitFrom, io.writeBack);
+	((ProcEntry*)io.process)->pagedIn = TRUE;
+	io.process->state = PROCESS_READY;
+	if(VMEM_NOISE) printf("SCHED: page-in of sPage %d done, PID %d ready\n", io.sPage, io.process->pid);
+	schedEnqueue(io.process);
+}
+/*================================================================================*/
+
+/*
+ * schedFinishAll
+ *    finish every page-in still queued, so that nothing is read from
+ *    secondary memory before a queued job has written it back: before a
+ *    synchronous fault and before an extended instruction
+ */
+static void schedFinishAll(){
+	while(nIos > 0){
+		schedFinishIO();
+	}
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * schedRelease
+ *    unpin the pages held for process, or with others TRUE, the pages
+ *    held for every other process
+ *    return: the number of pages unpinned
+ */
+static int schedRelease(Process *process, int others){
+	int kept = 0;
+	int released = nHeld;
+	for(int i = 0; i < nHeld; i++){
+		if((held[i].process == process) != others){
+			vmmUnpinPage(held[i].sPage);
+		}else{
+			held[kept++] = held[i];
+		}
+	}
+	released -= kept;
+	nHeld = kept;
+	return released;
+}
+
+/*
+ * schedMakeRoom
+ *    make sure some main page frame is free or can be evicted, by
+ *    unpinning other processes' pages, finishing page-ins and, as a
+ *    last resort, unpinning process's own pages
+ */
+static void schedMakeRoom(Process *process){
+	while(pageTableFindFreeMainPageFrame() == -1 && pageTableFindLRUFrame() == -1){
+		if(schedRelease(process, TRUE) > 0) continue;
+		if(nIos > 0){
+			schedFinishIO();
+		}else if(schedRelease(process, FALSE) == 0){
+			return;
+		}
+	}
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * schedRead - vmmReadHook while a process runs with async faults
+ *    the reads of an instruction are its fetch, its address word and
+ *    its data word, if it has them (the opcode tells); a read at pc
+ *    after those is the next fetch: remember the cpu as it is before it.
+ *    a data word can be at pc too (a thread's stack right after the
+ *    image), so pc alone does not tell
+ */
+static void schedRead(WORD vAddr, WORD word){
+	if(pendingAddr){
+		pendingAddr = FALSE;
+		return;
+	}
+	if(pendingData){
+		pendingData = FALSE;
+		return;
+	}
+	if(vAddr != cpu.pc) return;
+	INST_REG inst;
+	inst.w = word;
+	fetches++;
+	instCpu = cpu;
+	instClock = clock;
+	pendingAddr = HAS_ADDR_WORD(inst.s[0]);
+	pendingData = READS_DATA_WORD(inst.s[0]);
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * schedFault - vmmFaultHook while a process runs with async faults
+ *    queue the page-in and unwind out of the cpu (see schedQuantum)
+ *    returns only if the fault has to be taken synchronously, once the
+ *    page-ins queued before it are done (one may write sPage back)
+ *
+ *    a process that was just woken takes the faults of its first
+ *    instruction synchronously: otherwise, with many processes and few
+ *    frames, they can keep taking each other's pages before any of
+ *    them gets through an instruction. this holds even once the page it
+ *    waited for has been taken back (schedMakeRoom), which is when it
+ *    matters most
+ *
+ *    a page already being paged in (for another process, or a thread of
+ *    the same one) is not mapped until its job is done, so its frame is
+ *    never read early: the page-ins up to it are finished and it is
+ *    used as it lands
+ */
+static void schedFault(int pid, WORD vAddr, int sPage, int write){
+	int frame, writeBack;
+	PageioJob *job;
+
+	if(pageTable[sPage].pageIn != -1){
+		while(pageTable[sPage].pageIn != -1){
+			schedFinishIO();
+		}
+		return;
+	}
+	if(running == NULL || pid != running->pid){
+		schedFinishAll();
+		return;
+	}
+	schedMakeRoom(running);
+	job = NULL;
+	if(fetches > 1 || !woken) job = vmmPageInAsync(sPage, &frame, &writeBack);
+	if(job == NULL){
+		schedFinishAll();
+		return;
+	}
+
+	if(nIos == capIos){
+		capIos = capIos ? capIos * 2 : 64;
+		ios = realloc(ios, capIos * sizeof(SchedIO));
+		if(ios == NULL){
+			fprintf(stderr, "SCHED: out of memory\n");
+			exit(1);
+		}
+	}
+	long start = simCycles > ioBusyUntil ? simCycles : ioBusyUntil;
+	ioBusyUntil = start + costFaultCycles(getPageSize(), writeBack);
+	SchedIO io = {job, running, sPage, frame, writeBack, ioBusyUntil, simCycles};
+	ios[nIos++] = io;
+
+	/* a fault on an instruction fetch happens before the instruction starts */
+	if(write || vAddr != cpu.pc || pendingAddr || pendingData){
+		cpu = instCpu;
+		clock = instClock;
+	}
+	longjmp(faultJump, 1);
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * schedBusError - vmmBusErrorHook while a process runs
+ *    unwind to schedQuantum, which ends the process
+ */
+static void schedBusError(){
+	longjmp(busJump, 1);
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * schedRunQuantum - the quantum of schedQuantum
+ *    outside the cpu (extended instructions) faults are synchronous,
+ *    and page-ins still in flight are finished first
+ *
+ *    the registers of a process are saved when another process is
+ *    switched in, when it blocks and before an extended instruction
+ *    (xinstExecute works on the saved registers)
+ */
+static int schedRunQuantum(Process *process, int async){
+	int pid = process->pid;
+	long clockBefore = clock;
+	long faultsBefore = costFaults(pid);
+	int slices = schedSlices(process);
+	CPU_STATE cpuState;
+
+	/* pages move between memory tiers between quanta */
+	tierQuantum();
+
+	if(traceEnabled) traceEmit(TRACE_SWITCH, pid, dispatches, 0);
+	dispatches++;
+
+	if(async){
+		if(setjmp(faultJump) != 0){
+			/* the process faulted and was rolled back */
+			consoleDetach();
+			vmmReadHook = NULL;
+			vmmFaultHook = NULL;
+			running = NULL;
+			costChargeInst(pid, clock - clockBefore);
+			schedRelease(process, FALSE);
+			saveProcessState(process);
+			live = NULL;
+			schedAdapt(process, TRUE);
+			process->state = PROCESS_WAITING;
+			if(VMEM_NOISE) printf("SCHED: PID %d waiting at pc %ld\n", pid, process->cpu.pc);
+			if(replayMode) replayQuantum(pid, clock);
+			return SCHED_WAIT;
+		}
+		running = process;
+		pendingAddr = FALSE;
+		pendingData = FALSE;
+		fetches = 0;
+		woken = ((ProcEntry*)process)->pagedIn;
+		((ProcEntry*)process)->pagedIn = FALSE;
+		vmmReadHook = schedRead;
+		vmmFaultHook = schedFault;
+	}
+	consoleAttach(pid);
+	if(live == process){
+		resumes++;
+		cpuState = runCPU();
+	}else{
+		schedSaveLive();
+		switches++;
+		switchCycles += costModel.ctxSwitch;
+		costChargeSwitch(pid);
+		live = process;
+		cpuState = startProcess(process);
+	}
+	slicesRun++;
+	for(int slice = 1; slice < slices && cpuState == CLOCK_TICK; slice++){
+		slicesRun++;
+		cpuState = runCPU();
+	}
+	consoleDetach();
+	vmmReadHook = NULL;
+	vmmFaultHook = NULL;
+	running = NULL;
+	costChargeInst(pid, clock - clockBefore);
+	schedRelease(process, FALSE);
+	schedAdapt(process, costFaults(pid) != faultsBefore);
+
+	if(cpuState != CLOCK_TICK && cpuState != BAD_INSTR){
+		if(traceEnabled) traceEmit(TRACE_EXIT, pid, cpuState, 0);
+		exitState = cpuState;
+		return SCHED_DONE;
+	}
+
+	/* the CPU rejects extended instructions, the OS emulates them */
+	if(cpuState == BAD_INSTR){
+		if(VMEM_NOISE) printf("Saving state\n");
+		schedSaveLive();
+		schedFinishAll();
+		int emulated = xinstExecute(process);
+		if(emulated == -1){
+			if(traceEnabled) traceEmit(TRACE_EXIT, pid, cpuState, 0);
+			exitState = cpuState;
+			return SCHED_DONE;
+		}
+		costChargeInst(pid, 1);
+		if(emulated == XINST_WAIT){
+			if(VMEM_NOISE) printf("SCHED: PID %d waiting in JOIN\n", pid);
+			if(replayMode) replayQuantum(pid, clock);
+			return SCHED_WAIT;
+		}
+	}
+	if(replayMode) replayQuantum(pid, clock);
+	return SCHED_RUN;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * schedQuantum
+ *    a process that touches memory outside itself (or that secondary
+ *    memory has no room for) ends in BUS_ERROR, in the cpu or in an
+ *    extended instruction; FOS, which may be serving other jobs, goes on
+ */
+int schedQuantum(Process *process, int async){
+	long clockBefore = clock;
+	int result;
+
+	if(setjmp(busJump) != 0){
+		consoleDetach();
+		vmmReadHook = NULL;
+		vmmFaultHook = NULL;
+		vmmBusErrorHook = NULL;
+		running = NULL;
+		costChargeInst(process->pid, clock - clockBefore);
+		schedRelease(process, FALSE);
+		if(traceEnabled) traceEmit(TRACE_EXIT, process->pid, BUS_ERROR, 0);
+		exitState = BUS_ERROR;
+		return SCHED_DONE;
+	}
+	vmmBusErrorHook = schedBusError;
+	result = schedRunQuantum(process, async);
+	vmmBusErrorHook = NULL;
+	return result;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * schedTerminate
+ */
+void schedTerminate(Process *process){
+	if(VMEM_NOISE) printf("PROCESS %d TERMINATED\n", process->pid);
+	if(live == process) live = NULL;
+	consoleClose(process->pid);
+	pageTableProcessTerm(process->pid);
+	procTableFree(process);
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * schedEnd
+ *    process (or thread) has ended in exitState; the process is
+ *    terminated once its last thread has
+ */
+static void schedEnd(Process *process){
+	/* its reg[0] is what a JOIN of it gets */
+	if(live == process) schedSaveLive();
+	Process *ended = threadEnd(process, &exitState);
+	if(ended == NULL) return;
+	if(schedExitHook != NULL) schedExitHook(ended, exitState);
+	schedTerminate(ended);
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * schedDrain
+ *    run the ready queue until everything in it (and every thread it
+ *    starts) has ended. page-ins whose time has come are finished at
+ *    every quantum boundary. a thread left joining a thread that can
+ *    never end fails, which can free others
+ */
+static void schedDrain(int async){
+	Process *process;
+
+	initCPU();
+	for(;;){
+		while(nReady > 0 || nIos > 0){
+			while(nIos > 0 && ios[0].doneAt <= simCycles){
+				schedFinishIO();
+			}
+			process = schedDequeue();
+			if(process == NULL){
+				/* every process is waiting: skip to the next page-in */
+				schedFinishIO();
+				continue;
+			}
+			switch(schedQuantum(process, async)){
+			case SCHED_RUN:
+				schedEnqueue(process);
+				break;
+			case SCHED_DONE:
+				schedEnd(process);
+				break;
+			}
+		}
+		if((process = threadStuck()) == NULL) break;
+		fprintf(stderr, "PID %d: JOIN waits for a thread that can not end\n", process->pid);
+		exitState = BAD_INSTR;
+		schedEnd(process);
+	}
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * schedRun
+ */
+void schedRun(Process *process){
+	readyHead = 0;
+	nReady = 0;
+	schedEnqueue(process);
+	schedDrain(FALSE);
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * schedRunAll
+ */
+int schedRunAll(){
+	int slot = 0;
+	int count = 0;
+	Process *process;
+
+	readyHead = 0;
+	nReady = 0;
+	while((process = procTableNext(&slot)) != NULL){
+		if(process->state == PROCESS_READY){
+			schedEnqueue(process);
+			count++;
+		}
+	}
+	schedDrain(schedAsync);
+	return count;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * schedReport
+ */
+void schedReport(){
+	printf("=========================Scheduler=========================\n");
+	if(schedModel.adaptive){
+		printf("adaptive quantum, at most %d slices of %d instructions\n", schedModel.slices, RUN_LIMIT);
+	}else{
+		printf("fixed quantum of %d slices of %d instructions\n", schedModel.slices, RUN_LIMIT);
+	}
+	printf("quanta %ld\tslices %ld\tslices/quantum %.2f\n", dispatches, slicesRun,
+	       dispatches ? (double)slicesRun / dispatches : 0.0);
+	printf("context switches %ld\tlazy resumes %ld\tswitch cycles %ld\n", switches, resumes, switchCycles);
+	printf("threads started %ld\tjoined %ld\n", threadsSpawned, threadsJoined);
+	printf("===========================================================\n");
+}
+/*================================================================================*/
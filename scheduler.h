@@ -0,0 +1,139 @@
+/*
+ * scheduler.h
+ * process scheduling and asynchronous page faults for fos os
+ * Joshua Castelli/Nathan Helmig
+ *
+ * with asynchronous faults on, a process that faults is moved to
+ * PROCESS_WAITING, the page-in is queued to the I/O worker (pageio.c)
+ * and another ready process is dispatched. the cpu cannot be stopped
+ * in the middle of an instruction, so the fault unwinds out of the cpu
+ * and the process is rolled back to the start of the faulting
+ * instruction (a fault happens before the instruction writes anything)
+ * and runs it again once the page has landed
+ *
+ * I/O takes simulated time: one device serves the page-ins in order,
+ * each taking costFaultCycles. a waiting process is requeued when the
+ * simulated clock passes the end of its page-in; if nothing can run the
+ * clock skips ahead (idle cycles)
+ *
+ * a quantum is a number of cpu slices, each the RUN_LIMIT instructions
+ * runCPU runs at a time; within a quantum the process is not switched
+ * out between slices. a process dispatched again straight after its
+ * own quantum (it is the only one ready) keeps its registers in the
+ * cpu: it is neither saved nor restored, only resumed. a real context
+ * switch (restoring another process) costs costModel.ctxSwitch cycles
+ *
+ * the threads of a process (thread.h) are scheduled like processes; a
+ * thread waiting in JOIN is not queued until the thread it joins ends
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include "computer2.h"
+#include "fos-kernel2.h"
+
+#define SCHED_RUN 0     // the quantum ended, the process can run again
+#define SCHED_WAIT 1    // the process blocked on a page fault
+#define SCHED_DONE 2    // the process ended, or failed
+
+/*
+ * is asynchronous page fault handling on (used by runall)
+ */
+extern int schedAsync;
+
+/*
+ * schedExitHook - if set, schedRunAll calls it for every process that
+ * ends, before the process's pages and entry are released
+ *    state - the cpu state it ended with (PROCESS_END, BAD_INSTR for an
+ *            instruction neither the cpu nor the OS knows, BUS_ERROR)
+ */
+typedef void (*SchedExitHook)(Process *process, CPU_STATE state);
+
+extern SchedExitHook schedExitHook;
+
+/*
+ * SchedModel - quantum length
+ *    adaptive   0: every quantum is slices long
+ *               1: slices is the longest quantum. a process gets at
+ *                  most an equal share of it with the processes ready
+ *                  behind it, and its own length halves after a
+ *                  quantum in which it faulted and doubles after one
+ *                  without (a process changing its working set gives
+ *                  way sooner, a settled one switches less)
+ *    slices     in cpu slices of RUN_LIMIT instructions
+ */
+typedef struct {
+	int adaptive;
+	int slices;
+} SchedModel;
+
+extern SchedModel schedModel;
+
+/*
+ * schedSet
+ *    change one setting of the scheduler by name (adaptive, slices)
+ *
+ *    return
+ *       0 success
+ *       -1 unknown name or bad value
+ */
+int schedSet(char *name, int value);
+
+/*
+ * schedReport
+ *    print the quantum settings, the quanta and slices run, and the
+ *    context switches made and saved
+ */
+void schedReport();
+
+/*
+ * toggleAsyncIO
+ *    return: 1 if asynchronous faults are now on, 0 if off
+ */
+int toggleAsyncIO();
+
+/*
+ * schedQuantum
+ *    run process for one quantum, charging the cost model, emulating
+ *    extended instructions and logging trace and replay events
+ *
+ *    async - block the process on page faults instead of waiting
+ *
+ *    return
+ *       SCHED_RUN, SCHED_WAIT or SCHED_DONE
+ */
+int schedQuantum(Process *process, int async);
+
+/*
+ * schedWake
+ *    make a new thread, or one that was waiting in JOIN, ready and
+ *    queue it
+ */
+void schedWake(Process *process);
+
+/*
+ * schedTerminate
+ *    release the pages and process table entry of an ended process
+ *    and hand over its buffered console output
+ */
+void schedTerminate(Process *process);
+
+/*
+ * schedRun
+ *    run process, and the threads it starts, to completion round robin
+ *    by quantum, with synchronous page faults
+ */
+void schedRun(Process *process);
+
+/*
+ * schedRunAll
+ *    run every loaded process (and its threads) to completion, round
+ *    robin by quantum
+ *
+ *    return
+ *       the number of processes run
+ */
+int schedRunAll();
+
+#endif
@@ -0,0 +1,298 @@
+/*
+ * server.c
+ * unix domain socket transport for the fos os job server
+ * Joshua Castelli/Nathan Helmig
+ */
+
+#include "server.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+/*
+ * ServerClient - one connection
+ *    id      never reused
+ *    in      bytes received that do not make a whole line yet
+ *    tooLong the line being received has outgrown in, the rest of it
+ *            is thrown away
+ */
+typedef struct {
+	long id;
+	int fd;
+	int nIn;
+	int tooLong;
+	char in[SERVER_LINE];
+} ServerClient;
+
+/*
+ * ServerRequest - a whole line waiting to be taken
+ *    tooLong the line was too long, and is answered with an error
+ *            instead of being taken
+ */
+typedef struct {
+	long client;
+	int tooLong;
+	char line[SERVER_LINE];
+} ServerRequest;
+
+static int listenFd = -1;
+static char listenPath[108];
+static long nextClientId = 1;
+
+static ServerClient *clients = NULL;
+static int nClients = 0;
+static int capClients = 0;
+
+static ServerRequest *requests = NULL;
+static int nRequests = 0;
+static int capRequests = 0;
+static int firstRequest = 0;
+
+/*================================================================================*/
+/*
+ * serverOpen
+ */
+int serverOpen(char *socketPath){
+	struct sockaddr_un addr;
+
+	if(strlen(socketPath) >= sizeof(addr.sun_path)) return -1;
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, socketPath);
+	strcpy(listenPath, socketPath);
+
+	listenFd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if(listenFd == -1) return -1;
+	unlink(socketPath);
+	if(bind(listenFd, (struct sockaddr*)&addr, sizeof(addr)) != 0 || listen(listenFd, 64) != 0){
+		close(listenFd);
+		listenFd = -1;
+		return -1;
+	}
+	fcntl(listenFd, F_SETFL, O_NONBLOCK);
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * serverFind
+ *    index of the client with id, -1 if it is gone
+ */
+static int serverFind(long id){
+	for(int c = 0; c < nClients; c++){
+		if(clients[c].id == id) return c;
+	}
+	return -1;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * serverDrop
+ *    close client c; its requests still waiting are kept (their replies
+ *    go nowhere)
+ */
+static void serverDrop(int c){
+	close(clients[c].fd);
+	clients[c] = clients[--nClients];
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * serverQueue
+ *    add a request line from client
+ */
+static void serverQueue(long client, char *line, int tooLong){
+	if(firstRequest > 0 && firstRequest == nRequests){
+		firstRequest = 0;
+		nRequests = 0;
+	}
+	if(nRequests == capRequests){
+		capRequests = capRequests ? capRequests * 2 : 16;
+		requests = realloc(requests, capRequests * sizeof(ServerRequest));
+		if(requests == NULL){
+			fprintf(stderr, "SERVER: out of memory\n");
+			exit(1);
+		}
+	}
+	requests[nRequests].client = client;
+	requests[nRequests].tooLong = tooLong;
+	strcpy(requests[nRequests].line, tooLong ? "" : line);
+	nRequests++;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * serverAccept
+ *    take every connection waiting on the socket
+ */
+static void serverAccept(){
+	int fd;
+	while((fd = accept(listenFd, NULL, NULL)) != -1){
+		if(nClients == capClients){
+			capClients = capClients ? capClients * 2 : 16;
+			clients = realloc(clients, capClients * sizeof(ServerClient));
+			if(clients == NULL){
+				fprintf(stderr, "SERVER: out of memory\n");
+				exit(1);
+			}
+		}
+		fcntl(fd, F_SETFL, O_NONBLOCK);
+		clients[nClients].id = nextClientId++;
+		clients[nClients].fd = fd;
+		clients[nClients].nIn = 0;
+		clients[nClients].tooLong = 0;
+		nClients++;
+	}
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * serverRead
+ *    read what client c sent and queue its whole lines
+ *    a line too long for SERVER_LINE is thrown away up to its newline
+ *    and queued as too long
+ *
+ *    return
+ *       0 the client is still there
+ *       -1 it closed the connection (and was dropped)
+ */
+static int serverRead(int c){
+	ServerClient *client = &clients[c];
+	char buffer[4096];
+	ssize_t n;
+
+	while((n = read(client->fd, buffer, sizeof(buffer))) > 0){
+		for(ssize_t i = 0; i < n; i++){
+			if(buffer[i] == '\n'){
+				client->in[client->nIn] = 0;
+				if(client->nIn > 0 && client->in[client->nIn - 1] == '\r') client->in[client->nIn - 1] = 0;
+				serverQueue(client->id, client->in, client->tooLong);
+				client->nIn = 0;
+				client->tooLong = 0;
+			}else if(client->nIn == SERVER_LINE - 1){
+				client->tooLong = 1;
+			}else{
+				client->in[client->nIn++] = buffer[i];
+			}
+		}
+	}
+	if(n == 0){
+		serverDrop(c);
+		return -1;
+	}
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * serverWait
+ */
+int serverWait(int timeoutMs){
+	struct pollfd fds[nClients + 1];
+
+	if(nRequests > firstRequest) timeoutMs = 0;
+	fds[0].fd = listenFd;
+	fds[0].events = POLLIN;
+	for(int c = 0; c < nClients; c++){
+		fds[c + 1].fd = clients[c].fd;
+		fds[c + 1].events = POLLIN;
+	}
+	int polled = nClients;
+	if(poll(fds, polled + 1, timeoutMs) > 0){
+		/* read before accepting: accepting can not move the clients polled */
+		for(int c = polled - 1; c >= 0; c--){
+			if(fds[c + 1].revents & (POLLIN | POLLHUP | POLLERR)) serverRead(c);
+		}
+		if(fds[0].revents & POLLIN) serverAccept();
+	}
+	return nRequests - firstRequest;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * serverNextRequest
+ */
+int serverNextRequest(long *client, char line[SERVER_LINE]){
+	while(firstRequest < nRequests && requests[firstRequest].tooLong){
+		serverReply(requests[firstRequest].client, "error line too long");
+		firstRequest++;
+	}
+	if(firstRequest == nRequests) return 0;
+	*client = requests[firstRequest].client;
+	strcpy(line, requests[firstRequest].line);
+	firstRequest++;
+	return 1;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * serverReply
+ *    the socket is non-blocking; a client that stops reading is waited
+ *    for, one that has gone away is dropped
+ */
+void serverReply(long client, char *format, ...){
+	char line[SERVER_LINE + 1];
+	va_list args;
+	int c = serverFind(client);
+	if(c == -1) return;
+
+	va_start(args, format);
+	int len = vsnprintf(line, SERVER_LINE, format, args);
+	va_end(args);
+	if(len < 0) return;
+	if(len > SERVER_LINE - 1) len = SERVER_LINE - 1;
+	line[len++] = '\n';
+
+	for(int sent = 0; sent < len; ){
+		ssize_t n = send(clients[c].fd, line + sent, len - sent, MSG_NOSIGNAL);
+		if(n > 0){
+			sent += n;
+		}else{
+			struct pollfd out = {clients[c].fd, POLLOUT, 0};
+			if(n == -1 && poll(&out, 1, 1000) > 0 && !(out.revents & (POLLERR | POLLHUP))) continue;
+			serverDrop(c);
+			return;
+		}
+	}
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * serverDisconnect
+ */
+void serverDisconnect(long client){
+	int c = serverFind(client);
+	if(c != -1) serverDrop(c);
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * serverClose
+ */
+void serverClose(){
+	while(nClients > 0){
+		serverDrop(0);
+	}
+	if(listenFd != -1){
+		close(listenFd);
+		unlink(listenPath);
+		listenFd = -1;
+	}
+}
+/*================================================================================*/
@@ -0,0 +1,70 @@
+/*
+ * server.h
+ * unix domain socket transport for the fos os job server
+ * Joshua Castelli/Nathan Helmig
+ *
+ * the server listens on a socket path and talks to any number of
+ * local clients in lines of text. requests are read whole lines at a
+ * time; replies can be sent to a client at any time (a client that has
+ * gone away is dropped quietly). clients are known by an id that is
+ * never reused, so a late reply can not reach the wrong client
+ *
+ * like trace.c this does not include computer2.h
+ */
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#define SERVER_LINE 1024
+
+/*
+ * serverOpen
+ *    listen on socketPath (an old socket file there is removed)
+ *
+ *    return
+ *       0 success
+ *       -1 failure
+ */
+int serverOpen(char *socketPath);
+
+/*
+ * serverWait
+ *    accept new clients and read what they sent, waiting up to
+ *    timeoutMs for something to happen (-1: until it does)
+ *
+ *    return
+ *       the number of complete request lines waiting
+ */
+int serverWait(int timeoutMs);
+
+/*
+ * serverNextRequest
+ *    take the oldest complete request line (without its newline). a
+ *    line longer than SERVER_LINE - 1 is not taken: its client is
+ *    answered "error line too long" in its place
+ *
+ *    return
+ *       1 a line was copied to line and its client id to *client
+ *       0 no request is waiting
+ */
+int serverNextRequest(long *client, char line[SERVER_LINE]);
+
+/*
+ * serverReply
+ *    send one line (printf format, newline added) to client
+ */
+void serverReply(long client, char *format, ...);
+
+/*
+ * serverDisconnect
+ *    close the connection of client
+ */
+void serverDisconnect(long client);
+
+/*
+ * serverClose
+ *    close every connection and remove the socket file
+ */
+void serverClose();
+
+#endif
@@ -0,0 +1,269 @@
+/*
+ * thread.c
+ * guest threads for fos os
+ * Joshua Castelli/Nathan Helmig
+ */
+
+#include "thread.h"
+#include "proctab.h"
+#include "scheduler.h"
+#include "vmm.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+/*
+ * ThreadRec - one thread id of a process
+ *    entry      the thread's entry, NULL once it has ended
+ *    used       the id has not been joined yet
+ *    result     its reg[0] when it ended
+ *    stackBase  first word of its stack, -1 for the first thread
+ *    joiner     the thread waiting for it to end, if any, and the
+ *    joinReg    register that gets its result
+ */
+typedef struct {
+	Process *entry;
+	int used;
+	WORD result;
+	WORD stackBase;
+	Process *joiner;
+	int joinReg;
+} ThreadRec;
+
+/*
+ * ThreadGroup - the threads of one process
+ *    live         threads that have not ended, the first one included
+ *    firstState   the state the first thread ended in
+ *    freeStacks   stacks of ended threads, for the next ones started
+ */
+struct ThreadGroup {
+	Process *first;
+	int live;
+	CPU_STATE firstState;
+	ThreadRec *recs;
+	int nRecs;
+	int capRecs;
+	WORD *freeStacks;
+	int nFreeStacks;
+	int capFreeStacks;
+};
+typedef struct ThreadGroup ThreadGroup;
+
+long threadsSpawned = 0;
+long threadsJoined = 0;
+
+static ThreadGroup **groups = NULL;
+static int nGroups = 0;
+static int capGroups = 0;
+
+/*================================================================================*/
+/*
+ * threadAddRec
+ *    append rec to the thread ids of group
+ */
+static void threadAddRec(ThreadGroup *group, ThreadRec rec){
+	if(group->nRecs == group->capRecs){
+		group->capRecs = group->capRecs ? group->capRecs * 2 : 8;
+		group->recs = realloc(group->recs, group->capRecs * sizeof(ThreadRec));
+		if(group->recs == NULL){
+			fprintf(stderr, "THREAD: out of memory\n");
+			exit(1);
+		}
+	}
+	group->recs[group->nRecs++] = rec;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * threadGroup
+ *    the group of process, made (with process as thread 0) on the
+ *    first SPWN
+ */
+static ThreadGroup* threadGroup(Process *process){
+	ProcEntry *entry = (ProcEntry*)process;
+
+	if(entry->group != NULL) return entry->group;
+	ThreadGroup *group = calloc(1, sizeof(ThreadGroup));
+	if(group == NULL){
+		fprintf(stderr, "THREAD: out of memory\n");
+		exit(1);
+	}
+	group->first = process;
+	group->live = 1;
+	ThreadRec first = {process, TRUE, 0, -1, NULL, 0};
+	threadAddRec(group, first);
+
+	if(nGroups == capGroups){
+		capGroups = capGroups ? capGroups * 2 : 16;
+		groups = realloc(groups, capGroups * sizeof(ThreadGroup*));
+		if(groups == NULL){
+			fprintf(stderr, "THREAD: out of memory\n");
+			exit(1);
+		}
+	}
+	groups[nGroups++] = group;
+	entry->group = group;
+	entry->tid = 0;
+	return group;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * threadFreeGroup
+ */
+static void threadFreeGroup(ThreadGroup *group){
+	for(int g = 0; g < nGroups; g++){
+		if(groups[g] == group){
+			groups[g] = groups[--nGroups];
+			break;
+		}
+	}
+	((ProcEntry*)group->first)->group = NULL;
+	free(group->recs);
+	free(group->freeStacks);
+	free(group);
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * threadStackPages
+ *    pages in the stack of each thread of process
+ */
+static int threadStackPages(Process *process){
+	int pages = (process->stackSize + getPageSize() - 1) / getPageSize();
+	return pages > 0 ? pages : 1;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * threadSpawn
+ */
+int threadSpawn(Process *process, WORD pc, int reg){
+	ThreadGroup *group = threadGroup(process);
+	WORD stackBase;
+
+	if(group->nFreeStacks > 0){
+		stackBase = group->freeStacks[--group->nFreeStacks];
+	}else{
+		stackBase = vmmAddPages(process->pid, threadStackPages(process));
+		if(stackBase == -1) return -1;
+	}
+	Process *thread = procTableAlloc();
+	if(thread == NULL) return -1;
+
+	/* the kernel's part of the entry is a copy, the pid included */
+	*thread = *process;
+	thread->state = PROCESS_READY;
+	thread->cpu.pc = pc;
+	thread->cpu.sp = stackBase;
+	thread->cpu.reg[reg] = 0;
+	ProcEntry *entry = (ProcEntry*)thread;
+	entry->verified = ((ProcEntry*)process)->verified;
+	entry->group = group;
+	entry->tid = group->nRecs;
+
+	ThreadRec rec = {thread, TRUE, 0, stackBase, NULL, 0};
+	threadAddRec(group, rec);
+	group->live++;
+	process->cpu.reg[reg] = entry->tid;
+	threadsSpawned++;
+	if(VMEM_NOISE) printf("THREAD: PID %d started thread %d at %ld\n", process->pid, entry->tid, pc);
+	schedWake(thread);
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * threadJoin
+ */
+int threadJoin(Process *process, WORD tid, int reg){
+	ProcEntry *entry = (ProcEntry*)process;
+	ThreadGroup *group = entry->group;
+
+	if(group == NULL || tid < 0 || tid >= group->nRecs || tid == entry->tid) return -1;
+	ThreadRec *rec = &group->recs[tid];
+	if(!rec->used || rec->joiner != NULL) return -1;
+
+	if(rec->entry == NULL){
+		process->cpu.reg[reg] = rec->result;
+		rec->used = FALSE;
+		threadsJoined++;
+		return 0;
+	}
+	rec->joiner = process;
+	rec->joinReg = reg;
+	process->state = PROCESS_WAITING;
+	return 1;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * threadEnd
+ */
+Process* threadEnd(Process *process, CPU_STATE *state){
+	ProcEntry *entry = (ProcEntry*)process;
+	ThreadGroup *group = entry->group;
+
+	if(group == NULL) return process;
+	ThreadRec *rec = &group->recs[entry->tid];
+	rec->entry = NULL;
+	rec->result = process->cpu.reg[0];
+
+	/* it does not wait for anyone any more */
+	for(int t = 0; t < group->nRecs; t++){
+		if(group->recs[t].joiner == process) group->recs[t].joiner = NULL;
+	}
+	if(rec->joiner != NULL){
+		rec->joiner->cpu.reg[rec->joinReg] = rec->result;
+		rec->used = FALSE;
+		threadsJoined++;
+		schedWake(rec->joiner);
+		rec->joiner = NULL;
+	}
+	if(VMEM_NOISE) printf("THREAD: thread %d of PID %d ended\n", entry->tid, process->pid);
+
+	group->live--;
+	if(entry->tid == 0){
+		/* the entry stays registered: the vmm finds the pages through it */
+		group->firstState = *state;
+		process->state = PROCESS_WAITING;
+	}else{
+		vmmDropPages(process->pid, rec->stackBase, (WORD)threadStackPages(process) * getPageSize());
+		if(group->nFreeStacks == group->capFreeStacks){
+			group->capFreeStacks = group->capFreeStacks ? group->capFreeStacks * 2 : 8;
+			group->freeStacks = realloc(group->freeStacks, group->capFreeStacks * sizeof(WORD));
+			if(group->freeStacks == NULL){
+				fprintf(stderr, "THREAD: out of memory\n");
+				exit(1);
+			}
+		}
+		group->freeStacks[group->nFreeStacks++] = rec->stackBase;
+		procTableFree(process);
+	}
+	if(group->live > 0) return NULL;
+
+	Process *first = group->first;
+	*state = group->firstState;
+	threadFreeGroup(group);
+	return first;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * threadStuck
+ */
+Process* threadStuck(){
+	for(int g = 0; g < nGroups; g++){
+		for(int t = 0; t < groups[g]->nRecs; t++){
+			if(groups[g]->recs[t].joiner != NULL) return groups[g]->recs[t].joiner;
+		}
+	}
+	return NULL;
+}
+/*================================================================================*/
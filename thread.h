@@ -0,0 +1,85 @@
+/*
+ * thread.h
+ * guest threads for fos os
+ * Joshua Castelli/Nathan Helmig
+ *
+ * a thread is a register context of its own under a process: a
+ * process table entry that is not registered under a pid of its own
+ * but carries the pid of its process, so the cpu translates its
+ * addresses through the same page map and it shares every page of the
+ * process. threads are scheduled like processes, a quantum at a time
+ * (the os runs one cpu, so the threads of a process take turns on it)
+ *
+ * SPWN starts a thread at an address in the code with a copy of the
+ * registers of the thread that started it, and a stack of its own:
+ * stackSize words (at least a page) of zero filled pages added after
+ * the image, with sp at the first of them, as a process's stack starts
+ * at 0. JOIN waits for a thread to end and takes its reg[0]; a thread
+ * that ends keeps reg[0] until it is joined. a thread can be joined
+ * once, by any other thread of its process, the first one included
+ *
+ * the process ends when its last thread does: only then are its pages
+ * released, its output handed over and schedExitHook called, with the
+ * state its first thread ended in. the stack of a thread that ends goes
+ * back to the zero page, and to the next thread started
+ */
+
+#ifndef THREAD_H
+#define THREAD_H
+
+#include "computer2.h"
+#include "fos-kernel2.h"
+
+/*
+ * threads started and joined so far (for schedReport)
+ */
+extern long threadsSpawned;
+extern long threadsJoined;
+
+/*
+ * threadSpawn
+ *    start a thread of process at pc (its registers are the saved ones
+ *    of process, which gets the thread id in reg[reg]) and make it
+ *    ready (schedWake)
+ *
+ *    return
+ *       0 success
+ *       -1 out of memory
+ */
+int threadSpawn(Process *process, WORD pc, int reg);
+
+/*
+ * threadJoin
+ *    the JOIN of process: wait for thread tid of its process to end,
+ *    then put its reg[0] in reg[reg] of process
+ *
+ *    return
+ *       0 the thread had ended, reg[reg] is set
+ *       1 process waits (PROCESS_WAITING), it is woken with reg[reg]
+ *         set when the thread ends
+ *       -1 no such thread, the thread is process itself, or another
+ *          thread joins it already
+ */
+int threadJoin(Process *process, WORD tid, int reg);
+
+/*
+ * threadEnd
+ *    process (or thread) has ended in *state: wake whoever joins it,
+ *    free the entry of a thread, and tell whether the process is done
+ *    call with its registers saved
+ *
+ *    return
+ *       the process to terminate (schedTerminate), *state set to the
+ *       state its first thread ended in
+ *       NULL other threads of the process are still running
+ */
+Process* threadEnd(Process *process, CPU_STATE *state);
+
+/*
+ * threadStuck
+ *    a thread that joins a thread that can never end (nothing is ready
+ *    to run or waiting for a page), NULL if there is none
+ */
+Process* threadStuck();
+
+#endif
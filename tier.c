@@ -0,0 +1,223 @@
+/*
+ * tier.c
+ * two-tier main memory and hot/cold page migration for fos os
+ * Joshua Castelli/Nathan Helmig
+ */
+
+#include "tier.h"
+#include "vmm.h"
+#include "cost.h"
+#include "trace.h"
+#include "cache.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+TierModel tierModel = {
+	0,      // fast (one tier)
+	4,      // budget
+	1       // period
+};
+
+int tierSlowFrom = INT_MAX;
+
+static int *frameOwner = NULL;      // secondary page in each main frame, -1 if free
+static WORD *swapBuffer = NULL;
+static int nFrames = 0;
+static int pSize = 0;
+static int quanta = 0;
+
+static long epochs = 0;
+static long promotions = 0;
+static long demotions = 0;
+static long wordsMoved = 0;
+static long engineCycles = 0;
+
+/*================================================================================*/
+/*
+ * tierSet
+ *    return 0 success, -1 unknown name or bad value
+ */
+int tierSet(char *name, int value){
+	if(strcmp(name, "fast") == 0){
+		if(value < 0) return -1;
+		tierModel.fast = value;
+		tierSlowFrom = value > 0 && value < getNumMainPages() ? value : INT_MAX;
+	}else if(strcmp(name, "budget") == 0){
+		if(value < 0) return -1;
+		tierModel.budget = value;
+	}else if(strcmp(name, "period") == 0){
+		if(value < 1) return -1;
+		tierModel.period = value;
+	}else{
+		return -1;
+	}
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * tierMapFrames
+ *    fill frameOwner from the page table
+ *
+ *    return
+ *       0 success
+ *       -1 out of memory
+ */
+static int tierMapFrames(){
+	if(nFrames != getNumMainPages() || pSize != getPageSize()){
+		free(frameOwner);
+		free(swapBuffer);
+		nFrames = getNumMainPages();
+		pSize = getPageSize();
+		frameOwner = malloc(nFrames * sizeof(int));
+		swapBuffer = malloc(pSize * sizeof(WORD));
+		if(frameOwner == NULL || swapBuffer == NULL){
+			fprintf(stderr, "TIER: out of memory\n");
+			nFrames = 0;
+			return -1;
+		}
+	}
+	for(int f = 0; f < nFrames; f++){
+		frameOwner[f] = -1;
+	}
+	for(int i = 0; i < getNumSecPages(); i++){
+		if(pageTable[i].free == FALSE && pageTable[i].mainPageFrame != -1){
+			frameOwner[pageTable[i].mainPageFrame] = i;
+		}
+		/* a frame a page-in is filling is not free (its page is pinned) */
+		if(pageTable[i].pageIn != -1) frameOwner[pageTable[i].pageIn] = i;
+	}
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * tierSwap
+ *    move the page in slow frame hot to fast frame cold, and the page in
+ *    cold (if any) to hot
+ */
+static void tierSwap(int hot, int cold){
+	int hotPage = frameOwner[hot];
+	int coldPage = frameOwner[cold];
+
+	if(coldPage != -1){
+		memcpy(swapBuffer, &mainMem[cold*pSize], pSize * sizeof(WORD));
+	}
+	memcpy(&mainMem[cold*pSize], &mainMem[hot*pSize], pSize * sizeof(WORD));
+	pageTable[hotPage].mainPageFrame = cold;
+	promotions++;
+	wordsMoved += pSize;
+	if(traceEnabled) traceEmit(TRACE_MIGRATE, pageTable[hotPage].pid, hotPage, cold);
+
+	if(coldPage != -1){
+		memcpy(&mainMem[hot*pSize], swapBuffer, pSize * sizeof(WORD));
+		pageTable[coldPage].mainPageFrame = hot;
+		demotions++;
+		wordsMoved += pSize;
+		if(traceEnabled) traceEmit(TRACE_MIGRATE, pageTable[coldPage].pid, coldPage, hot);
+	}
+	cacheInvalidateFrame(hot);
+	cacheInvalidateFrame(cold);
+	frameOwner[cold] = hotPage;
+	frameOwner[hot] = coldPage;
+	engineCycles += (coldPage != -1 ? 2 : 1) * pSize * costModel.migrate;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * tierMigrate
+ *    promote the hottest unpinned slow-tier page into a free fast frame,
+ *    or in place of the coldest unpinned fast-tier page if that one has
+ *    less than half its count (so that two pages about as hot do not
+ *    keep trading places), until the budget is spent; then age every count
+ */
+int tierMigrate(){
+	int moved = 0;
+
+	if(tierSlowFrom >= getNumMainPages() || tierMapFrames() != 0) return 0;
+	epochs++;
+
+	while(moved < tierModel.budget){
+		int hot = -1;
+		int cold = -1;
+		for(int f = tierSlowFrom; f < nFrames; f++){
+			int s = frameOwner[f];
+			if(s == -1 || pageTable[s].pinned > 0 || pageTable[s].refs == 0) continue;
+			if(hot == -1 || pageTable[s].refs > pageTable[frameOwner[hot]].refs) hot = f;
+		}
+		if(hot == -1) break;
+		for(int f = 0; f < tierSlowFrom; f++){
+			int s = frameOwner[f];
+			if(s == -1){
+				cold = f;
+				break;
+			}
+			if(pageTable[s].pinned > 0) continue;
+			if(cold == -1 || pageTable[s].refs < pageTable[frameOwner[cold]].refs) cold = f;
+		}
+		if(cold == -1) break;
+		if(frameOwner[cold] != -1 && 2 * pageTable[frameOwner[cold]].refs >= pageTable[frameOwner[hot]].refs) break;
+		tierSwap(hot, cold);
+		moved++;
+	}
+
+	for(int f = 0; f < nFrames; f++){
+		if(frameOwner[f] != -1) pageTable[frameOwner[f]].refs >>= 1;
+	}
+	if(VMEM_NOISE && moved > 0) printf("TIER: migrated %d pages\n", moved);
+	return moved;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * tierQuantum
+ */
+void tierQuantum(){
+	if(tierSlowFrom >= getNumMainPages()) return;
+	if(++quanta >= tierModel.period){
+		quanta = 0;
+		tierMigrate();
+	}
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * tierReport
+ */
+void tierReport(){
+	int frames = getNumMainPages();
+	int fast = tierSlowFrom < frames ? tierSlowFrom : frames;
+	int used[2] = {0, 0};
+	long total = fastTierCycles + slowTierCycles;
+
+	for(int i = 0; i < getNumSecPages(); i++){
+		if(pageTable[i].free == FALSE && pageTable[i].mainPageFrame != -1){
+			used[pageTable[i].mainPageFrame >= fast]++;
+		}
+	}
+	printf("=========================Memory Tiers=========================\n");
+	if(fast == frames){
+		printf("one tier: frames 0-%d, mem %ld\n", frames - 1, costModel.memAccess);
+	}else{
+		printf("fast tier: frames 0-%d, mem %ld\tslow tier: frames %d-%d, slowmem %ld\n",
+		       fast - 1, costModel.memAccess, fast, frames - 1, costModel.slowAccess);
+	}
+	printf("budget %d pages/epoch\tperiod %d quanta\tmigrate %ld/word\n",
+	       tierModel.budget, tierModel.period, costModel.migrate);
+	printf("Tier\tFrames\tUsed\tCycles\tCycles%%\n");
+	printf("fast\t%d\t%d\t%ld\t%.1f\n", fast, used[0], fastTierCycles,
+	       total ? 100.0 * fastTierCycles / total : 0.0);
+	printf("slow\t%d\t%d\t%ld\t%.1f\n", frames - fast, used[1], slowTierCycles,
+	       total ? 100.0 * slowTierCycles / total : 0.0);
+	printf("epochs %ld\tpromotions %ld\tdemotions %ld\twords moved %ld\tengine cycles %ld\n",
+	       epochs, promotions, demotions, wordsMoved, engineCycles);
+	printf("==============================================================\n");
+}
+/*================================================================================*/
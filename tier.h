@@ -0,0 +1,79 @@
+/*
+ * tier.h
+ * two-tier main memory and hot/cold page migration for fos os
+ * Joshua Castelli/Nathan Helmig
+ *
+ * main page frames [0, fast) are the fast tier, the rest the slow tier.
+ * an access costs costModel.memAccess in the fast tier and
+ * costModel.slowAccess in the slow one (see cost.h). a page fault takes
+ * the lowest free frame, so new pages go to the fast tier while it has
+ * room
+ *
+ * every page in main memory counts its accesses (PageTableRec.refs).
+ * at the end of every epoch (a number of quanta) the migration engine
+ * swaps the hottest slow-tier pages with the coldest fast-tier ones,
+ * up to a budget of pages, then halves every count so that hotness
+ * follows the recent past. the engine works beside the cpu: its copies
+ * take costModel.migrate cycles per word of engine time but do not
+ * stall any process. pinned pages are never moved
+ */
+
+#ifndef TIER_H
+#define TIER_H
+
+#include "computer2.h"
+
+/*
+ * TierModel - placement policy
+ *    fast      main page frames in the fast tier (0: one tier, all fast)
+ *    budget    pages the engine may promote per epoch
+ *    period    quanta per epoch
+ */
+typedef struct {
+	int fast;
+	int budget;
+	int period;
+} TierModel;
+
+extern TierModel tierModel;
+
+/*
+ * first main page frame of the slow tier
+ * (INT_MAX while main memory is one tier)
+ */
+extern int tierSlowFrom;
+
+/*
+ * tierSet
+ *    change one setting of the tier model by name (fast, budget, period)
+ *
+ *    return
+ *       0 success
+ *       -1 unknown name or bad value
+ */
+int tierSet(char *name, int value);
+
+/*
+ * tierQuantum
+ *    call at every quantum boundary; runs the migration engine at the
+ *    end of each epoch
+ */
+void tierQuantum();
+
+/*
+ * tierMigrate
+ *    run one epoch of the migration engine now
+ *
+ *    return
+ *       the number of pages moved
+ */
+int tierMigrate();
+
+/*
+ * tierReport
+ *    print the tier model, the pages in each tier, the cycles spent
+ *    accessing each tier and what the migration engine has done
+ */
+void tierReport();
+
+#endif
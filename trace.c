@@ -0,0 +1,191 @@
+/*
+ * trace.c
+ * low-overhead binary event tracing for fos os
+ * Joshua Castelli/Nathan Helmig
+ */
+
+#include "trace.h"
+#include "hrtime.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <time.h>
+
+/*
+ * TraceRing - single producer (the cpu), single consumer (drain thread)
+ *    head is only written by the producer, tail only by the consumer
+ */
+typedef struct {
+	_Atomic unsigned long head;
+	char padHead[64 - sizeof(unsigned long)];
+	_Atomic unsigned long tail;
+	char padTail[64 - sizeof(unsigned long)];
+	_Atomic long dropped;
+	TraceEvent events[TRACE_RING_SIZE];
+} TraceRing;
+
+int traceEnabled = 0;
+
+static TraceRing *rings = NULL;
+static FILE *traceFile = NULL;
+static pthread_t drainThread;
+static _Atomic int drainRunning = 0;
+static long long traceT0 = 0;
+static long written = 0;
+static int atExitSet = 0;
+static __thread int traceCpu = 0;
+
+/*================================================================================*/
+/*
+ * traceDrainOnce
+ *    copy everything currently in the rings to the file
+ *    return: number of events copied
+ */
+static long traceDrainOnce(){
+	long copied = 0;
+	for(int c = 0; c < TRACE_MAX_CPUS; c++){
+		TraceRing *r = &rings[c];
+		unsigned long tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+		unsigned long head = atomic_load_explicit(&r->head, memory_order_acquire);
+		while(tail != head){
+			unsigned long start = tail & (TRACE_RING_SIZE - 1);
+			unsigned long n = head - tail;
+			if(start + n > TRACE_RING_SIZE) n = TRACE_RING_SIZE - start;
+			fwrite(&r->events[start], sizeof(TraceEvent), n, traceFile);
+			tail += n;
+			copied += n;
+		}
+		atomic_store_explicit(&r->tail, tail, memory_order_release);
+	}
+	written += copied;
+	return copied;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * traceDrain
+ *    drain thread: empty the rings, nap briefly when they are empty
+ */
+static void* traceDrain(void *unused){
+	struct timespec nap = {0, 1000000};
+	(void)unused;
+	while(atomic_load(&drainRunning)){
+		if(traceDrainOnce() == 0){
+			nanosleep(&nap, NULL);
+		}
+	}
+	return NULL;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * traceAtExit
+ *    a trace left running is finished when the OS exits
+ */
+static void traceAtExit(){
+	traceStop();
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * traceStart
+ *    return: 0 success, -1 failure
+ */
+int traceStart(char *fileName){
+	if(traceEnabled) return -1;
+	if(rings == NULL){
+		rings = calloc(TRACE_MAX_CPUS, sizeof(TraceRing));
+		if(rings == NULL) return -1;
+	}
+	traceFile = fopen(fileName, "wb");
+	if(traceFile == NULL) return -1;
+
+	TraceHeader h;
+	memset(&h, 0, sizeof(h));
+	memcpy(h.magic, TRACE_MAGIC, 8);
+	h.version = TRACE_VERSION;
+	h.eventSize = sizeof(TraceEvent);
+	fwrite(&h, sizeof(h), 1, traceFile);
+
+	for(int c = 0; c < TRACE_MAX_CPUS; c++){
+		atomic_store(&rings[c].head, 0);
+		atomic_store(&rings[c].tail, 0);
+		atomic_store(&rings[c].dropped, 0);
+	}
+	written = 0;
+	traceT0 = hrtimeNow();
+	atomic_store(&drainRunning, 1);
+	if(pthread_create(&drainThread, NULL, traceDrain, NULL) != 0){
+		fclose(traceFile);
+		traceFile = NULL;
+		return -1;
+	}
+	traceEnabled = 1;
+	if(!atExitSet){
+		atexit(traceAtExit);
+		atExitSet = 1;
+	}
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * traceStop
+ *    return: events dropped
+ */
+long traceStop(){
+	if(!traceEnabled) return 0;
+	traceEnabled = 0;
+	atomic_store(&drainRunning, 0);
+	pthread_join(drainThread, NULL);
+	traceDrainOnce();
+	fclose(traceFile);
+	traceFile = NULL;
+
+	long dropped = 0;
+	for(int c = 0; c < TRACE_MAX_CPUS; c++){
+		dropped += atomic_load(&rings[c].dropped);
+	}
+	return dropped;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+void traceSetCpu(int cpuId){
+	if(cpuId >= 0 && cpuId < TRACE_MAX_CPUS) traceCpu = cpuId;
+}
+
+long traceEventsWritten(){
+	return written;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * traceEmit
+ *    never blocks: a full ring drops the event
+ */
+void traceEmit(int type, int pid, int arg0, int arg1){
+	TraceRing *r = &rings[traceCpu];
+	unsigned long head = atomic_load_explicit(&r->head, memory_order_relaxed);
+	if(head - atomic_load_explicit(&r->tail, memory_order_acquire) >= TRACE_RING_SIZE){
+		atomic_fetch_add_explicit(&r->dropped, 1, memory_order_relaxed);
+		return;
+	}
+	TraceEvent *e = &r->events[head & (TRACE_RING_SIZE - 1)];
+	e->ts = hrtimeNow() - traceT0;
+	e->type = type;
+	e->cpu = traceCpu;
+	e->pid = pid;
+	e->arg0 = arg0;
+	e->arg1 = arg1;
+	e->pad = 0;
+	atomic_store_explicit(&r->head, head + 1, memory_order_release);
+}
+/*================================================================================*/
@@ -0,0 +1,101 @@
+/*
+ * trace.h
+ * low-overhead binary event tracing for fos os
+ * Joshua Castelli/Nathan Helmig
+ *
+ * each emulated cpu writes fixed-size events into its own lock-free
+ * ring buffer; a drain thread copies them to the trace file, so the
+ * fault and translation paths never wait on I/O. a full ring drops
+ * the event and counts it rather than blocking.
+ *
+ * trace2json converts a trace file to Chrome/Perfetto trace JSON
+ *
+ * like hrtime.c, trace.c must not include computer2.h (pthread.h
+ * pulls in time.h)
+ */
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#define TRACE_MAX_CPUS 4
+#define TRACE_RING_SIZE 65536    // events per cpu, power of 2
+
+#define TRACE_MAGIC "FOSTRACE"
+#define TRACE_VERSION 1
+
+/*
+ * event types and what arg0/arg1 hold
+ */
+typedef enum {
+	TRACE_FAULT,        // vPage, sPage
+	TRACE_EVICT,        // sPage, mPageFrame
+	TRACE_WRITEBACK,    // sPage, mPageFrame
+	TRACE_SWITCH,       // pid is the process dispatched, arg0 the quantum
+	TRACE_LOAD,         // pages loaded, code size
+	TRACE_EXIT,         // cpu state the process ended with
+	TRACE_MIGRATE,      // sPage, the mPageFrame it moved to
+	TRACE_PREFETCH,     // vPage, sPage read in ahead of use
+	TRACE_NUM_TYPES
+} TRACE_TYPE;
+
+/*
+ * TraceEvent - one record of the trace file, after the header
+ *    ts    nanoseconds since traceStart
+ */
+typedef struct {
+	long long ts;
+	int type;
+	int cpu;
+	int pid;
+	int arg0;
+	int arg1;
+	int pad;
+} TraceEvent;
+
+/*
+ * TraceHeader - start of every trace file
+ */
+typedef struct {
+	char magic[8];
+	int version;
+	int eventSize;
+} TraceHeader;
+
+extern int traceEnabled;
+
+/*
+ * traceStart
+ *    open fileName and start the drain thread. a trace still running
+ *    when the OS exits is stopped then (as by traceStop), so no event
+ *    in the rings is lost
+ *    return: 0 success, -1 failure (file could not be opened)
+ */
+int traceStart(char *fileName);
+
+/*
+ * traceStop
+ *    stop the drain thread, write what is left and close the file
+ *    return: number of events dropped because a ring was full
+ */
+long traceStop();
+
+/*
+ * traceSetCpu
+ *    the cpu the calling thread emulates (default 0)
+ */
+void traceSetCpu(int cpuId);
+
+/*
+ * traceEmit
+ *    record an event on the calling thread's cpu ring
+ *    callers check traceEnabled first
+ */
+void traceEmit(int type, int pid, int arg0, int arg1);
+
+/*
+ * traceEventsWritten
+ *    return: events written to the file so far
+ */
+long traceEventsWritten();
+
+#endif
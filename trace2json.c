@@ -0,0 +1,124 @@
+/*
+ * trace2json.c
+ * converts a fos os binary trace file to Chrome/Perfetto trace JSON
+ * Joshua Castelli/Nathan Helmig
+ *
+ * usage: trace2json fos.trace > fos.json
+ *    open the output in chrome://tracing or ui.perfetto.dev
+ *
+ * each emulated cpu is a thread of the "FOS" track; a SWITCH event
+ * opens a slice named after the dispatched pid that lasts until the
+ * next SWITCH (or EXIT) on that cpu. faults, evictions, write-backs
+ * and loads are instant events.
+ */
+
+/**************************************************************
+	#includes
+**************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "trace.h"
+
+/**************************************************************
+	Global Variables
+**************************************************************/
+char *typeNames[TRACE_NUM_TYPES] = {"fault", "evict", "writeback", "switch", "load", "exit", "migrate", "prefetch"};
+char *arg0Names[TRACE_NUM_TYPES] = {"vPage", "sPage", "sPage", "quantum", "pages", "state", "sPage", "vPage"};
+char *arg1Names[TRACE_NUM_TYPES] = {"sPage", "mPageFrame", "mPageFrame", "", "codeSize", "", "mPageFrame", "sPage"};
+
+int running[TRACE_MAX_CPUS];    // pid of the open slice on each cpu, 0 if none
+int first = 1;
+
+/**************************************************************
+	Prototypes
+**************************************************************/
+void printSeparator();
+void endSlice(TraceEvent *e);
+
+
+/**************************************************************
+	Functions
+**************************************************************/
+
+void printSeparator(){
+	printf(first ? "\n" : ",\n");
+	first = 0;
+}
+
+/****End Slice*************************************************
+	close the running slice of e's cpu, if any
+**************************************************************/
+void endSlice(TraceEvent *e){
+	if(running[e->cpu] == 0) return;
+	printSeparator();
+	printf("{\"name\":\"pid %d\",\"ph\":\"E\",\"ts\":%.3f,\"pid\":1,\"tid\":%d}",
+	       running[e->cpu], e->ts / 1000.0, e->cpu);
+	running[e->cpu] = 0;
+}
+
+/****MAIN******************************************************
+	MAIN FUNCTION - reads the trace, writes JSON to stdout
+**************************************************************/
+int main(int argc, char* argv[]){
+	if(argc != 2){
+		fprintf(stderr, "Usage: %s traceFile\n", argv[0]);
+		exit(1);
+	}
+	FILE *fin = fopen(argv[1], "rb");
+	if(fin == NULL){
+		fprintf(stderr, "failed to open %s\n", argv[1]);
+		exit(1);
+	}
+
+	TraceHeader h;
+	if(fread(&h, sizeof(h), 1, fin) != 1 || memcmp(h.magic, TRACE_MAGIC, 8) != 0
+	   || h.version != TRACE_VERSION || h.eventSize != sizeof(TraceEvent)){
+		fprintf(stderr, "%s is not a FOS trace (version %d)\n", argv[1], TRACE_VERSION);
+		exit(1);
+	}
+
+	printf("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+	printSeparator();
+	printf("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"FOS\"}}");
+	for(int c = 0; c < TRACE_MAX_CPUS; c++){
+		printSeparator();
+		printf("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"cpu %d\"}}", c, c);
+	}
+
+	TraceEvent e;
+	TraceEvent last;
+	memset(&last, 0, sizeof(last));
+	long count = 0;
+	while(fread(&e, sizeof(e), 1, fin) == 1){
+		if(e.type < 0 || e.type >= TRACE_NUM_TYPES || e.cpu < 0 || e.cpu >= TRACE_MAX_CPUS) continue;
+		count++;
+		last = e;
+		if(e.type == TRACE_SWITCH){
+			if(running[e.cpu] == e.pid) continue;
+			endSlice(&e);
+			printSeparator();
+			printf("{\"name\":\"pid %d\",\"ph\":\"B\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,\"args\":{\"quantum\":%d}}",
+			       e.pid, e.ts / 1000.0, e.cpu, e.arg0);
+			running[e.cpu] = e.pid;
+			continue;
+		}
+		printSeparator();
+		printf("{\"name\":\"%s\",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f,\"pid\":1,\"tid\":%d,"
+		       "\"args\":{\"pid\":%d,\"%s\":%d",
+		       typeNames[e.type], e.ts / 1000.0, e.cpu, e.pid, arg0Names[e.type], e.arg0);
+		if(arg1Names[e.type][0] != 0) printf(",\"%s\":%d", arg1Names[e.type], e.arg1);
+		printf("}}");
+		if(e.type == TRACE_EXIT && running[e.cpu] == e.pid) endSlice(&e);
+	}
+	for(int c = 0; c < TRACE_MAX_CPUS; c++){
+		last.cpu = c;
+		endSlice(&last);
+	}
+	printf("\n]}\n");
+	fprintf(stderr, "%ld events\n", count);
+
+	fclose(fin);
+	return 0;
+}
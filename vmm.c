@@ -8,7 +8,14 @@
 #include "vmm.h"
 #include "computer2.h"
 #include "fos-kernel2.h"
+#include "prof.h"
+#include "cost.h"
+#include "trace.h"
+#include "proctab.h"
+#include "tier.h"
+#include "cache.h"
 #include <stdlib.h>
+#include <string.h>
 // #include <stdio.h>
 
 /*
@@ -23,6 +30,117 @@
  *
  */
 
+static WORD *blockBuffer = NULL;
+
+int vmmZeroPage = -1;
+long vmmZeroFills = 0;
+
+VmmCounts vmmCounts = {0, 0, 0, 0};
+
+/*
+ * the free secondary frames (vmmCounts.free of them, the lowest last, as
+ * pageTableRecount lists them) and where each frame is in freeSec, -1 if
+ * it is not free: a frame is reserved, or goes free, without a search
+ */
+static int *freeSec = NULL;
+static int *freeSecAt = NULL;
+
+/*
+ * VmmSeqRange - virtual pages first to last of pid were advised
+ * SEQUENTIAL (see vmmAdvise)
+ */
+typedef struct {
+	int pid;
+	int first;
+	int last;
+} VmmSeqRange;
+
+static VmmSeqRange *seqRanges = NULL;
+static int nSeqRanges = 0;
+static int capSeqRanges = 0;
+
+/* the stack window (see vmmStackAccess), stackPid 0 when there is none */
+static VmmSpan stackWindow;
+static int stackPid = 0;
+
+long vmmStackHits = 0;
+long vmmStackMoves = 0;
+
+/*================================================================================*/
+/*
+ * pageTableSetFree / pageTableSetFrame / pageTableSetDirty
+ *    change one field of a record and the counts that depend on it
+ *    a frame going free joins the free runs on either side of it, and
+ *    the end of the free list
+ */
+static void pageTableSetFree(int page, int free){
+	if((pageTable[page].free == TRUE) == (free == TRUE)) return;
+	int neighbours = (page > 0 && pageTable[page-1].free == TRUE)
+	               + (page < getNumSecPages() - 1 && pageTable[page+1].free == TRUE);
+	int change = free == TRUE ? 1 : -1;
+	if(free == TRUE){
+		freeSecAt[page] = vmmCounts.free;
+		freeSec[vmmCounts.free] = page;
+	}else{
+		int last = freeSec[vmmCounts.free - 1];
+		freeSec[freeSecAt[page]] = last;
+		freeSecAt[last] = freeSecAt[page];
+		freeSecAt[page] = -1;
+	}
+	vmmCounts.free += change;
+	vmmCounts.freeExtents += change * (1 - neighbours);
+	pageTable[page].free = free;
+}
+
+static void pageTableSetFrame(int page, int mPageFrame){
+	int change = (mPageFrame != -1) - (pageTable[page].mainPageFrame != -1);
+	pageTable[page].mainPageFrame = mPageFrame;
+	if(change == 0) return;
+	vmmCounts.resident += change;
+	procTableCountPages(pageTable[page].pid, change, 0);
+}
+
+static void pageTableSetDirty(int page, int dirty){
+	if((pageTable[page].dirty == TRUE) == (dirty == TRUE)) return;
+	int change = dirty == TRUE ? 1 : -1;
+	pageTable[page].dirty = dirty;
+	vmmCounts.dirty += change;
+	procTableCountPages(pageTable[page].pid, 0, change);
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmAddSequential / vmmForgetSequential
+ *    add a SEQUENTIAL range of pid, or drop the advice for virtual pages
+ *    first to last (a range that sticks out on both sides is split)
+ */
+static void vmmAddSequential(int pid, int first, int last){
+	if(nSeqRanges == capSeqRanges){
+		capSeqRanges = capSeqRanges ? capSeqRanges * 2 : 16;
+		seqRanges = realloc(seqRanges, capSeqRanges * sizeof(VmmSeqRange));
+		if(seqRanges == NULL){
+			fprintf(stderr, "VMEM: out of memory\n");
+			exit(1);
+		}
+	}
+	seqRanges[nSeqRanges].pid = pid;
+	seqRanges[nSeqRanges].first = first;
+	seqRanges[nSeqRanges].last = last;
+	nSeqRanges++;
+}
+
+static void vmmForgetSequential(int pid, int first, int last){
+	for(int r = nSeqRanges - 1; r >= 0; r--){
+		VmmSeqRange range = seqRanges[r];
+		if(range.pid != pid || range.last < first || range.first > last) continue;
+		seqRanges[r] = seqRanges[--nSeqRanges];
+		if(range.first < first) vmmAddSequential(pid, range.first, first - 1);
+		if(range.last > last) vmmAddSequential(pid, last + 1, range.last);
+	}
+}
+/*================================================================================*/
+
 /*================================================================================*/
 /*
  * initVMM
@@ -34,6 +152,7 @@
  */
 int initVMM(){
 	if(VMEM_NOISE) printf("VMEM: init\n");
+	stackPid = 0;
 	// create memory for and initialize page table(s)
 	pageTable = calloc(getNumSecPages(), sizeof(PageTableRec));
 	if(pageTable == 0){
@@ -44,6 +163,24 @@ int initVMM(){
 	  pageTable[page].free = TRUE;
 	  pageTable[page].vPage = -1;
 	  pageTable[page].mainPageFrame = -1;
+	  pageTable[page].pageIn = -1;
+	}
+	pageTableRecount();
+
+	// the shared zero page that untouched stack and heap pages map to
+	if(pageTableReserveSecPages(1, &vmmZeroPage) != 0){
+	  fprintf(stderr, "no secondary page for the zero page\n");
+	  return 2;
+	}
+	memset(&secMem[vmmZeroPage*getPageSize()], 0, getPageSize() * sizeof(WORD));
+	vmmZeroFills = 0;
+
+	// one page of staging for vmmBlockCopy
+	free(blockBuffer);
+	blockBuffer = malloc(getPageSize() * sizeof(WORD));
+	if(blockBuffer == 0){
+	  fprintf(stderr, "failed to create block copy buffer\n");
+	  return 2;
 	}
 
 	return 0;
@@ -61,18 +198,12 @@ int initVMM(){
  */
 int pageTableGetFreeSecPage(Process pTableEntry){
 	if(VMEM_NOISE) printf("VMEM: Searching for secondary page...\n");
-	int success = -1;
-	int found = -1;
-	for(int i = 0; i < getNumSecPages(); i++){
-		if(pageTable[i].free == TRUE && found == -1){
-			pageTable[i].free=FALSE;
-			pageTable[i].vPage = i;
-			pageTable[i].pid = pTableEntry.pid;
-			success = i;
-			found = 0;
-		}
-	}
-	return success;
+	if(vmmCounts.free == 0) return -1;
+	int i = freeSec[vmmCounts.free - 1];
+	pageTableSetFree(i, FALSE);
+	pageTable[i].vPage = i;
+	pageTable[i].pid = pTableEntry.pid;
+	return i;
 }
 /*================================================================================*/
 
@@ -89,18 +220,76 @@ int pageTableGetFreeSecPage(Process pTableEntry){
  */
 int pageTableLoadProcessToSecFrame(int sPageFrame, int pid){
     if(VMEM_NOISE) printf("VMEM: Loading sPageFrame %d\n",sPageFrame);
-	int success = -1;
- 	for(int i = 0; i < getNumSecPages(); i++){
-		if(pageTable[i].vPage == sPageFrame){
-			pageTable[i].pid = pid;
-			success = 0;
-		}	
-	} 
-    return success;
+	if(sPageFrame < 0 || sPageFrame >= getNumSecPages()) return -1;
+	pageTable[sPageFrame].pid = pid;
+	return procTableAddPage(pid, sPageFrame) == -1 ? -1 : 0;
 }
 /*================================================================================*/
 
 
+/*================================================================================*/
+/*
+ * pageTableReserveSecPages
+ *    frames come off the end of the free list; reserved frames have
+ *    free == FALSE and pid == 0
+ *
+ * return
+ *    0 success
+ *    -1 failure
+ */
+int pageTableReserveSecPages(int pages, int frames[]){
+	if(VMEM_NOISE) printf("VMEM: Reserving %d secondary pages\n",pages);
+	if(pages > vmmCounts.free) return -1;
+	for(int i = 0; i < pages; i++){
+		int page = freeSec[vmmCounts.free - 1];
+		pageTableSetFree(page, FALSE);
+		pageTable[page].pid = 0;
+		pageTable[page].vPage = -1;
+		pageTableSetFrame(page, -1);
+		pageTableSetDirty(page, FALSE);
+		pageTable[page].pinned = 0;
+		pageTable[page].refs = 0;
+		frames[i] = page;
+	}
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * pageTableReleaseSecPages
+ */
+void pageTableReleaseSecPages(int frames[], int pages){
+	for(int i = 0; i < pages; i++){
+		pageTableSetFree(frames[i], TRUE);
+		pageTable[frames[i]].pid = 0;
+		pageTable[frames[i]].vPage = -1;
+	}
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * pageTableCommitSecPages
+ */
+void pageTableCommitSecPages(int frames[], int pages, int pid){
+	if(VMEM_NOISE) printf("VMEM: Committing %d sPageFrames to PID %d\n",pages,pid);
+	for(int i = 0; i < pages; i++){
+		pageTable[frames[i]].pid = pid;
+		pageTable[frames[i]].vPage = procTableAddPage(pid, frames[i]);
+	}
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * pageTableMapZeroPage
+ */
+int pageTableMapZeroPage(int pid){
+	return procTableAddPage(pid, vmmZeroPage) == -1 ? -1 : 0;
+}
+/*================================================================================*/
+
 /*================================================================================*/
 /*
  * pageTableAccessPageFrame
@@ -122,14 +311,16 @@ int pageTableAccessPageFrame(int mPageFrame, int write){
 		for(int i = 0; i < getNumSecPages(); i++){
 			if(pageTable[i].mainPageFrame == mPageFrame){
 				pageTable[i].lastRef = clock;
+				pageTable[i].refs++;
 				success = 0;
 			}
 		}
 	}else{
 		for(int i = 0; i < getNumSecPages(); i++){
 			if(pageTable[i].mainPageFrame == mPageFrame){
-				pageTable[i].dirty = TRUE;
+				pageTableSetDirty(i, TRUE);
 				pageTable[i].lastRef = clock;
+				pageTable[i].refs++;
 				success = 0;
 			}
 		}
@@ -147,15 +338,81 @@ int pageTableAccessPageFrame(int mPageFrame, int write){
  *       void
  */
 void pageTableProcessTerm(int pid){
-	if(VMEM_NOISE) printf("VMEM: \n");
-	for(int i = 0; i < getNumSecPages(); i++){
+	if(VMEM_NOISE) printf("VMEM: Releasing the pages of PID %d\n",pid);
+	if(pid == stackPid) vmmStackDrop();
+	int *secPages;
+	int nPages = procTablePages(pid, &secPages);
+	for(int vPage = 0; vPage < nPages; vPage++){
+		int i = secPages[vPage];
 		if(pageTable[i].pid == pid){
+			pageTableSetFrame(i, -1);
+			pageTableSetDirty(i, FALSE);
 			pageTable[i].pid = 0;
-			pageTable[i].free = TRUE;
+			pageTableSetFree(i, TRUE);
 			pageTable[i].vPage = -1;
-			pageTable[i].mainPageFrame = -1;
+			pageTable[i].pinned = 0;
+			pageTable[i].refs = 0;
+		}
+	}
+	procTableClearPages(pid);
+	vmmForgetSequential(pid, 0, nPages - 1);
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * pageTableRecount
+ *    also lists the free frames again, highest first, so that frames
+ *    are reserved from the bottom of secondary memory up
+ */
+void pageTableRecount(){
+	VmmCounts counts = {0, 0, 0, 0};
+
+	free(freeSec);
+	free(freeSecAt);
+	freeSec = malloc(getNumSecPages() * sizeof(int));
+	freeSecAt = malloc(getNumSecPages() * sizeof(int));
+	if(freeSec == NULL || freeSecAt == NULL){
+		fprintf(stderr, "VMEM: out of memory\n");
+		exit(1);
+	}
+	procTableResetCounts();
+	for(int i = getNumSecPages() - 1; i >= 0; i--){
+		freeSecAt[i] = -1;
+		if(pageTable[i].free == TRUE){
+			freeSecAt[i] = counts.free;
+			freeSec[counts.free++] = i;
+			if(i == getNumSecPages() - 1 || pageTable[i+1].free != TRUE) counts.freeExtents++;
+		}
+		if(pageTable[i].mainPageFrame != -1){
+			counts.resident++;
+			procTableCountPages(pageTable[i].pid, 1, 0);
+		}
+		if(pageTable[i].dirty == TRUE){
+			counts.dirty++;
+			procTableCountPages(pageTable[i].pid, 0, 1);
 		}
 	}
+	vmmCounts = counts;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * pageTableChecksum
+ *    FNV-1a over the records
+ */
+unsigned long pageTableChecksum(){
+	unsigned long sum = 14695981039346656037ul;
+	for(int i = 0; i < getNumSecPages(); i++){
+		int fields[8] = {pageTable[i].free, pageTable[i].pid, pageTable[i].vPage,
+		                 pageTable[i].mainPageFrame, pageTable[i].dirty,
+		                 pageTable[i].lastRef, pageTable[i].pinned, pageTable[i].refs};
+		for(int f = 0; f < 8; f++){
+			sum = (sum ^ (unsigned)fields[f]) * 1099511628211ul;
+		}
+	}
+	return sum;
 }
 /*================================================================================*/
 
@@ -178,10 +435,13 @@ int pageTableCopyToPageFrame(int sPageFrame, int mPageFrame){
 	
 	int success = -1;
 	
-	pageTable[sPageFrame].mainPageFrame = mPageFrame;
+	pageTableSetFrame(sPageFrame, mPageFrame);
+	cacheInvalidateFrame(mPageFrame);
 	
 	if(pageTable[sPageFrame].mainPageFrame == mPageFrame){
-		success == 0;
+		pageTableSetDirty(sPageFrame, FALSE);
+		pageTable[sPageFrame].refs = 0;
+		success = 0;
 	}
 	
 	
@@ -217,7 +477,7 @@ void pageTablePageEvicted(int pid, int mPageFrame){
 	for(int i = 0; i < getNumSecPages(); i++){
 		if(pageTable[i].pid == pid){
 			if(pageTable[i].mainPageFrame == mPageFrame){
-				pageTable[i].mainPageFrame = -1;
+				pageTableSetFrame(i, -1);
 			}
 		}
 	}
@@ -246,6 +506,10 @@ int pageTableFindFreeMainPageFrame(){
 	  if(pageTable[page].free == FALSE && pageTable[page].mainPageFrame != -1){
 		 pageFrame[pageTable[page].mainPageFrame] = pageTable[page].pid;
 	  }
+	  // a frame a page-in is filling is taken too
+	  if(pageTable[page].pageIn != -1){
+		 pageFrame[pageTable[page].pageIn] = pageTable[page].pid;
+	  }
 	}
 
 	for(int page=0; page < getNumMainPages(); page++){
@@ -273,7 +537,7 @@ int pageTableFindLRUFrame(){
 	int index = -1;
 	
 	for(int i = 0; i < getNumSecPages(); i++){
-		if(pageTable[i].mainPageFrame > -1){
+		if(pageTable[i].mainPageFrame > -1 && pageTable[i].pinned == 0){
 			if(last == -1){
 				last = pageTable[i].lastRef;
 				index = i;
@@ -290,6 +554,814 @@ int pageTableFindLRUFrame(){
 }
 /*================================================================================*/
 
+/*================================================================================*/
+/*
+ * vmmCopySecToMain / vmmCopyMainToSec
+ *    page-in and write-back copies; memcpy is vectorized by the C library
+ */
+int vmmCopySecToMain(int sStart, int mStart, int words){
+	if(sStart < 0 || mStart < 0 || sStart + words > getSecMemSize() || mStart + words > getMainMemSize()){
+		fprintf(stderr, "copy outside memory in vmmCopySecToMain\n");
+		return -1;
+	}
+	memcpy(&mainMem[mStart], &secMem[sStart], words * sizeof(WORD));
+	return 0;
+}
+
+int vmmCopyMainToSec(int mStart, int sStart, int words){
+	if(sStart < 0 || mStart < 0 || sStart + words > getSecMemSize() || mStart + words > getMainMemSize()){
+		fprintf(stderr, "copy outside memory in vmmCopyMainToSec\n");
+		return -1;
+	}
+	memcpy(&secMem[sStart], &mainMem[mStart], words * sizeof(WORD));
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmSecPage
+ *    the secondary page frame holding virtual page vpage of pid
+ *    looked up in the page map the process table keeps for pid
+ *
+ *    return
+ *       the secondary page frame
+ *       -1 if pid has no such page
+ */
+static int vmmSecPage(int pid, int vpage){
+	int *secPages;
+	int nPages = procTablePages(pid, &secPages);
+
+	if(vpage < 0 || vpage >= nPages){
+		return -1;
+	}
+	return secPages[vpage];
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmBusError
+ *    the access of process pid cannot be made (the reason is printed
+ *    already); see vmmBusErrorHook
+ */
+static void vmmBusError(int pid){
+	if(VMEM_NOISE) printf("VMEM: bus error of PID %d\n", pid);
+	if(vmmBusErrorHook != NULL) vmmBusErrorHook();
+	exit(1);
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmZeroFill
+ *    give virtual page vpage of pid, which maps to the zero page, a
+ *    secondary frame of its own, filled with zeros
+ *
+ *    return
+ *       the new secondary page frame
+ */
+static int vmmZeroFill(int pid, int vpage){
+	int sPage;
+	if(pageTableReserveSecPages(1, &sPage) != 0){
+		fprintf(stderr, "out of secondary memory: PID %d cannot write to page %d\n", pid, vpage);
+		vmmBusError(pid);
+	}
+	memset(&secMem[sPage*getPageSize()], 0, getPageSize() * sizeof(WORD));
+	pageTable[sPage].pid = pid;
+	pageTable[sPage].vPage = vpage;
+	procTableSetPage(pid, vpage, sPage);
+	vmmZeroFills++;
+	if(VMEM_NOISE) printf("VMEM: Zero fill of vPage %d of PID %d in sPage %d\n",vpage,pid,sPage);
+	return sPage;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmChargeAccesses
+ *    charge pid count main memory accesses to the page holding pAddr,
+ *    at the latency of its tier
+ */
+static void vmmChargeAccesses(int pid, WORD pAddr, long count){
+	if(pAddr / getPageSize() >= tierSlowFrom){
+		costChargeSlowAccesses(pid, count);
+	}else{
+		costChargeAccesses(pid, count);
+	}
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmStackAccess
+ *    physical address of vAddr of pid if it is in the stack window,
+ *    with the bookkeeping translate does for a page already resident
+ *
+ *    return
+ *       the physical address
+ *       -1 vAddr is not in the window (translate it)
+ */
+static WORD vmmStackAccess(int pid, WORD vAddr, int write){
+	WORD offset = vAddr - stackWindow.vAddr;
+	if(pid != stackPid || offset < 0 || offset >= stackWindow.words) return -1;
+
+	int sPage = stackWindow.sPage;
+	pageTable[sPage].lastRef = clock;
+	pageTable[sPage].refs++;
+	if(write && pageTable[sPage].dirty != TRUE) pageTableSetDirty(sPage, TRUE);
+	vmmStackHits++;
+	return stackWindow.pAddr + offset;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmStackMove
+ *    vAddr of pid was just translated to pAddr outside the window; if
+ *    it is a stack address, move the window to its page (pages still
+ *    mapped to the zero page are left out, their first write copies them)
+ *
+ *    the stack addresses are [0, stackSize) and the stacks of its
+ *    threads: every page past the image is one of those (vmmAddPages
+ *    is only used by threadSpawn)
+ */
+static void vmmStackMove(int pid, WORD vAddr, WORD pAddr){
+	int pSize = getPageSize();
+
+	/* another process is running */
+	if(stackPid != 0 && stackPid != pid) vmmStackDrop();
+
+	Process *process = procTableFind(pid);
+	if(process == NULL || getNumMainPages() < 2) return;
+	WORD imageSize = process->stackSize + process->heapSize + process->codeSize;
+	WORD threadStacks = (imageSize + pSize - 1) / pSize * pSize;
+	if(vAddr >= process->stackSize && vAddr < threadStacks) return;
+	int sPage = vmmSecPage(pid, vAddr / pSize);
+	if(sPage == vmmZeroPage) return;
+
+	vmmStackDrop();
+	pageTable[sPage].pinned++;
+	stackWindow.vAddr = vAddr - vAddr % pSize;
+	stackWindow.pAddr = pAddr - vAddr % pSize;
+	stackWindow.words = pSize;
+	stackWindow.sPage = sPage;
+	stackPid = pid;
+	vmmStackMoves++;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmStackDrop
+ */
+void vmmStackDrop(){
+	if(stackPid == 0) return;
+	if(pageTable[stackWindow.sPage].pinned > 0) pageTable[stackWindow.sPage].pinned--;
+	stackPid = 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmPrefetch
+ *    read virtual page vpage of pid (in secondary frame sPage) into main
+ *    memory ahead of use, replacing the LRU page if no frame is free,
+ *    and give it lastRef
+ *
+ *    return
+ *       1 the page was read in
+ *       0 it was already in main memory
+ *       -1 there is no frame to put it in (every page is pinned)
+ */
+static int vmmPrefetch(int pid, int vpage, int sPage, int lastRef){
+	if(pageTable[sPage].mainPageFrame != -1 || pageTable[sPage].pageIn != -1) return 0;
+
+	int frame = pageTableFindFreeMainPageFrame();
+	if(frame == -1){
+		if(pageTableFindLRUFrame() == -1) return -1;
+		frame = vmmPath->pageReplacement(pid);
+	}
+	vmmCopySecToMain(sPage*getPageSize(), frame*getPageSize(), getPageSize());
+	pageTableCopyToPageFrame(sPage, frame);
+	pageTable[sPage].lastRef = lastRef;
+	costChargePrefetch(pid, getPageSize());
+	if(traceEnabled) traceEmit(TRACE_PREFETCH, pid, vpage, sPage);
+	if(VMEM_NOISE) printf("VMEM: Prefetched vPage %d of PID %d into mPage %d\n",vpage,pid,frame);
+	return 1;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmSequentialFault
+ *    pid has just faulted vpage in; if the page lies in a SEQUENTIAL
+ *    range, read ahead in it and make the pages already passed (all but
+ *    the one just behind vpage) the first to be replaced
+ */
+static void vmmSequentialFault(int pid, int vpage){
+	int *secPages;
+	int nPages = procTablePages(pid, &secPages);
+	int ahead = getNumMainPages() / 4 < VMM_READAHEAD ? getNumMainPages() / 4 : VMM_READAHEAD;
+	int r;
+
+	for(r = 0; r < nSeqRanges; r++){
+		if(seqRanges[r].pid == pid && seqRanges[r].first <= vpage && vpage <= seqRanges[r].last) break;
+	}
+	if(r == nSeqRanges) return;
+	VmmSeqRange range = seqRanges[r];
+
+	/* the page just faulted in must stay while the pages ahead come in */
+	int sPage = secPages[vpage];
+	pageTable[sPage].pinned++;
+	for(int v = vpage + 1; v <= range.last && v <= vpage + ahead && v < nPages; v++){
+		if(secPages[v] == vmmZeroPage) continue;
+		if(vmmPrefetch(pid, v, secPages[v], clock - 1) == -1) break;
+	}
+	pageTable[sPage].pinned--;
+
+	for(int v = vpage - 2; v >= range.first; v--){
+		if(secPages[v] == vmmZeroPage) continue;
+		if(pageTable[secPages[v]].mainPageFrame == -1) break;
+		pageTable[secPages[v]].lastRef = 0;
+	}
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * the read/write/fault path is built twice from vmmpath.h,
+ * once without any diagnostics and once with them
+ */
+#define VMM_INSTRUMENTED 0
+#define VMM_PATH(name) name##Lean
+#include "vmmpath.h"
+#undef VMM_INSTRUMENTED
+#undef VMM_PATH
+
+#define VMM_INSTRUMENTED 1
+#define VMM_PATH(name) name##Instr
+#include "vmmpath.h"
+#undef VMM_INSTRUMENTED
+#undef VMM_PATH
+
+VmmPathOps *vmmPath = &vmmPathOpsLean;
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmSelectPath
+ *    use the instrumented path while vmem noise, the profiler or
+ *    tracing is on, and the lean path otherwise
+ *
+ *    return
+ *       1 if the instrumented path was selected, 0 for lean
+ */
+int vmmSelectPath(){
+	if(VMEM_NOISE || profEnabled || traceEnabled){
+		vmmPath = &vmmPathOpsInstr;
+		return 1;
+	}
+	vmmPath = &vmmPathOpsLean;
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmTranslate
+ *    physical address of vAddr for the running process
+ */
+WORD vmmTranslate(WORD vAddr, int write){
+	WORD pAddr = vmmPath->translate(cpu.pid, vAddr, write);
+	vmmChargeAccesses(cpu.pid, pAddr, 1);
+	return pAddr;
+}
+/*================================================================================*/
+
+VmmReadHook vmmReadHook = NULL;
+VmmFaultHook vmmFaultHook = NULL;
+VmmBusErrorHook vmmBusErrorHook = NULL;
+WORD vmmLastRead = 0;
+
+/*================================================================================*/
+/*
+ * vmmPageInAsync
+ *    same choice of frame and victim as the synchronous fault path
+ */
+PageioJob* vmmPageInAsync(int sPage, int *frame, int *writeBack){
+	int victim = -1;
+
+	*frame = pageTableFindFreeMainPageFrame();
+	*writeBack = FALSE;
+	if(*frame == -1){
+		victim = pageTableFindLRUFrame();
+		if(victim == -1) return NULL;
+		*frame = pageTable[victim].mainPageFrame;
+		*writeBack = pageTable[victim].dirty == TRUE;
+	}
+
+	WORD *wbDst = *writeBack ? &secMem[victim*getPageSize()] : NULL;
+	PageioJob *job = pageioSubmit(wbDst, &mainMem[*frame*getPageSize()],
+	                              &mainMem[*frame*getPageSize()], &secMem[sPage*getPageSize()], getPageSize());
+	if(job == NULL) return NULL;
+
+	if(victim != -1){
+		if(traceEnabled && *writeBack) traceEmit(TRACE_WRITEBACK, pageTable[victim].pid, victim, *frame);
+		if(traceEnabled) traceEmit(TRACE_EVICT, pageTable[victim].pid, victim, *frame);
+		pageTableSetDirty(victim, FALSE);
+		pageTablePageEvicted(pageTable[victim].pid, *frame);
+	}
+	if(VMEM_NOISE) printf("VMEM: Paging sPage %d into mPage %d asynchronously\n",sPage,*frame);
+	pageTable[sPage].pageIn = *frame;
+	pageTable[sPage].pinned++;
+	return job;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmPageInDone
+ */
+void vmmPageInDone(int sPage, int frame){
+	pageTable[sPage].pageIn = -1;
+	pageTableCopyToPageFrame(sPage, frame);
+	pageTable[sPage].lastRef = clock;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmUnpinPage
+ */
+void vmmUnpinPage(int sPage){
+	if(pageTable[sPage].pinned > 0) pageTable[sPage].pinned--;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmBlockCopy
+ *    each span lies inside one source page and one destination page;
+ *    it goes through blockBuffer so that faulting the destination in
+ *    can never evict the source out from under the copy.
+ *    when dstV is inside the source range the spans are taken from the end
+ */
+int vmmBlockCopy(WORD srcV, WORD dstV, WORD words){
+	int pSize = getPageSize();
+	int backward = dstV > srcV && dstV < srcV + words;
+	WORD done = 0;
+
+	while(done < words){
+		WORD left = words - done;
+		WORD s, d, n;
+		if(!backward){
+			s = srcV + done;
+			d = dstV + done;
+			n = pSize - s % pSize;
+			if(pSize - d % pSize < n) n = pSize - d % pSize;
+			if(left < n) n = left;
+		}else{
+			n = (srcV + left - 1) % pSize + 1;
+			if((dstV + left - 1) % pSize + 1 < n) n = (dstV + left - 1) % pSize + 1;
+			if(left < n) n = left;
+			s = srcV + left - n;
+			d = dstV + left - n;
+		}
+		WORD sAddr = vmmTranslate(s, FALSE);
+		memcpy(blockBuffer, &mainMem[sAddr], n * sizeof(WORD));
+		WORD dAddr = vmmTranslate(d, TRUE);
+		memcpy(&mainMem[dAddr], blockBuffer, n * sizeof(WORD));
+		vmmChargeAccesses(cpu.pid, sAddr, n - 1);
+		vmmChargeAccesses(cpu.pid, dAddr, n - 1);
+		done += n;
+	}
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmBlockFill
+ */
+int vmmBlockFill(WORD dstV, WORD value, WORD words){
+	int pSize = getPageSize();
+	WORD done = 0;
+
+	while(done < words){
+		WORD d = dstV + done;
+		WORD n = pSize - d % pSize;
+		if(words - done < n) n = words - done;
+		WORD pAddr = vmmTranslate(d, TRUE);
+		WORD *p = &mainMem[pAddr];
+		for(WORD i = 0; i < n; i++){
+			p[i] = value;
+		}
+		vmmChargeAccesses(cpu.pid, pAddr, n - 1);
+		done += n;
+	}
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmPinRange
+ *    each page is pinned as soon as it is in, so faulting in the rest
+ *    of the range can not evict it
+ */
+int vmmPinRange(int pid, WORD vAddr, WORD words, int write, VmmSpan spans[], int maxSpans){
+	int pSize = getPageSize();
+	int nSpans = 0;
+	int freeFrames = getNumMainPages();
+
+	if(vAddr < 0 || words <= 0) return -1;
+	if((vAddr + words - 1) / pSize - vAddr / pSize + 1 > maxSpans) return -1;
+
+	/* every page of the range must be able to sit in main memory at once */
+	for(int i = 0; i < getNumSecPages(); i++){
+		if(pageTable[i].pinned > 0 && pageTable[i].mainPageFrame != -1) freeFrames--;
+	}
+	for(WORD v = vAddr - vAddr % pSize; v < vAddr + words; v += pSize){
+		int sPage = vmmSecPage(pid, v / pSize);
+		if(sPage == -1) return -1;
+		if(pageTable[sPage].pinned == 0 || pageTable[sPage].mainPageFrame == -1) freeFrames--;
+	}
+	if(freeFrames < 0) return -1;
+
+	WORD v = vAddr;
+	while(v < vAddr + words){
+		WORD n = pSize - v % pSize;
+		if(vAddr + words - v < n) n = vAddr + words - v;
+		spans[nSpans].vAddr = v;
+		spans[nSpans].pAddr = vmmPath->translate(pid, v, write);
+		vmmChargeAccesses(pid, spans[nSpans].pAddr, 1);
+		spans[nSpans].words = n;
+		spans[nSpans].sPage = vmmSecPage(pid, v / pSize);
+		pageTable[spans[nSpans].sPage].pinned++;
+		nSpans++;
+		v += n;
+	}
+	return nSpans;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmUnpinRange
+ */
+void vmmUnpinRange(VmmSpan spans[], int nSpans){
+	for(int i = 0; i < nSpans; i++){
+		if(pageTable[spans[i].sPage].pinned > 0){
+			pageTable[spans[i].sPage].pinned--;
+		}
+	}
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmDump
+ *    the range is pinned VMM_DUMP_SPANS pages at a time, fewer when
+ *    other pinned pages (the stack window, a process's own pins) leave
+ *    less of main memory free; it fails only when not even one page fits
+ */
+int vmmDump(int pid, WORD vAddr, WORD words){
+	int pSize = getPageSize();
+	VmmSpan spans[VMM_DUMP_SPANS];
+	int pages = VMM_DUMP_SPANS;
+
+	while(words > 0){
+		WORD chunk = (WORD)pages * pSize - vAddr % pSize;
+		if(words < chunk) chunk = words;
+		int nSpans = vmmPinRange(pid, vAddr, chunk, FALSE, spans, VMM_DUMP_SPANS);
+		if(nSpans == -1){
+			if(pages > 1){
+				pages /= 2;
+				continue;
+			}
+			printf("cannot dump PID %d at %ld\n", pid, vAddr);
+			return -1;
+		}
+		for(int i = 0; i < nSpans; i++){
+			for(WORD w = 0; w < spans[i].words; w++){
+				INST_REG word;
+				word.w = mainMem[spans[i].pAddr + w];
+				if(word.s[0] >= 'A' && word.s[0] <= 'z'){
+					printf("%04ld\t%.4s\n", spans[i].vAddr + w, word.s);
+				}else{
+					printf("%04ld\t%ld\n", spans[i].vAddr + w, word.w);
+				}
+			}
+		}
+		vmmUnpinRange(spans, nSpans);
+		vAddr += chunk;
+		words -= chunk;
+	}
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmKernelSize
+ *    the kernel keeps the memory sizes to itself and has no setter, it
+ *    only sets them when it makes memory. so have it make memory of the
+ *    new size and move the contents (the first oldWords words, as many
+ *    as fit) into it; at most the old and the new memory exist at once
+ *
+ *    this assumes create allocates a new buffer into *mem (the kernel's
+ *    mainMem or secMem), leaving the old one alone, and that size()
+ *    then reports words. the new buffer and the size are checked: FOS
+ *    stops if the kernel does otherwise, as the old buffer can then be
+ *    neither kept nor freed safely
+ *
+ *    return 0 success, -1 failure (nothing changed)
+ */
+static int vmmKernelSize(WORD **mem, int (*create)(int), int (*size)(), int oldWords, int words){
+	WORD *kept = *mem;
+	if(create(words) != 0){
+		*mem = kept;
+		return -1;
+	}
+	if(*mem == kept || *mem == NULL || size() != words){
+		fprintf(stderr, "VMEM: the kernel did not make new memory of %d words\n", words);
+		exit(1);
+	}
+	memcpy(*mem, kept, (size_t)(oldWords < words ? oldWords : words) * sizeof(WORD));
+	if(words > oldWords) memset(&(*mem)[oldWords], 0, (size_t)(words - oldWords) * sizeof(WORD));
+	free(kept);
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmEvict
+ *    write secondary page sPage back if it is dirty and take it out of
+ *    main memory, as page replacement does with its victim
+ */
+static void vmmEvict(int sPage){
+	int frame = pageTable[sPage].mainPageFrame;
+
+	if(pageTable[sPage].dirty == TRUE){
+		vmmCopyMainToSec(frame*getPageSize(), sPage*getPageSize(), getPageSize());
+		costChargeWriteBack(pageTable[sPage].pid, getPageSize());
+		if(traceEnabled) traceEmit(TRACE_WRITEBACK, pageTable[sPage].pid, sPage, frame);
+		pageTableSetDirty(sPage, FALSE);
+	}
+	if(traceEnabled) traceEmit(TRACE_EVICT, pageTable[sPage].pid, sPage, frame);
+	pageTablePageEvicted(pageTable[sPage].pid, frame);
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmResizeMain
+ *    pages in the frames that go away are evicted first; none of them
+ *    may be pinned
+ */
+int vmmResizeMain(int words, char error[128]){
+	int pSize = getPageSize();
+	int frames = words / pSize;
+	int oldFrames = getNumMainPages();
+
+	vmmStackDrop();
+	if(words <= 0 || words % pSize != 0){
+		snprintf(error, 128, "size must be a positive multiple of the page size (%d)", pSize);
+		return -1;
+	}
+	for(int i = 0; i < getNumSecPages() && frames < oldFrames; i++){
+		if(pageTable[i].mainPageFrame >= frames && pageTable[i].pinned > 0){
+			snprintf(error, 128, "main page frame %d is pinned", pageTable[i].mainPageFrame);
+			return -1;
+		}
+	}
+
+	if(frames < oldFrames){
+		for(int i = 0; i < getNumSecPages(); i++){
+			if(pageTable[i].mainPageFrame >= frames) vmmEvict(i);
+		}
+		for(int f = frames; f < oldFrames; f++){
+			cacheInvalidateFrame(f);
+		}
+	}
+	if(vmmKernelSize(&mainMem, createMainMem, getMainMemSize, getMainMemSize(), words) != 0){
+		snprintf(error, 128, "the kernel could not resize main memory");
+		return -1;
+	}
+
+	/* the fast tier is cut to what is left, or grows back to its size */
+	tierSet("fast", tierModel.fast);
+	if(VMEM_NOISE) printf("VMEM: main memory resized from %d to %d frames\n",oldFrames,frames);
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmMoveSecPage
+ *    move the page in secondary frame from to free frame to, with its
+ *    record and the process table's map (counts are redone by the caller)
+ */
+static void vmmMoveSecPage(int from, int to){
+	int pSize = getPageSize();
+	int pid = pageTable[from].pid;
+	int *secPages;
+
+	memcpy(&secMem[to*pSize], &secMem[from*pSize], pSize * sizeof(WORD));
+	pageTable[to] = pageTable[from];
+	pageTable[from].free = TRUE;
+	pageTable[from].pid = 0;
+	pageTable[from].vPage = -1;
+	pageTable[from].mainPageFrame = -1;
+	pageTable[from].dirty = FALSE;
+	pageTable[from].pinned = 0;
+	pageTable[from].refs = 0;
+	pageTable[from].pageIn = -1;
+
+	int nPages = procTablePages(pid, &secPages);
+	for(int vPage = 0; vPage < nPages; vPage++){
+		if(secPages[vPage] == from) secPages[vPage] = to;
+	}
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmResizeSec
+ *    growing only adds free frames at the end; shrinking first moves the
+ *    pages in the frames that go away into free frames below the new end
+ */
+int vmmResizeSec(int words, char error[128]){
+	int pSize = getPageSize();
+	int pages = words / pSize;
+	int oldPages = getNumSecPages();
+
+	vmmStackDrop();
+	if(words <= 0 || words % pSize != 0){
+		snprintf(error, 128, "size must be a positive multiple of the page size (%d)", pSize);
+		return -1;
+	}
+
+	if(pages < oldPages){
+		int moving = 0;
+		int freeBelow = 0;
+		for(int i = 0; i < oldPages; i++){
+			if(i < pages) freeBelow += pageTable[i].free == TRUE;
+			else moving += pageTable[i].free != TRUE;
+		}
+		if(vmmZeroPage >= pages || moving > freeBelow){
+			snprintf(error, 128, "%d pages in use do not fit in %d pages", oldPages - vmmCounts.free, pages);
+			return -1;
+		}
+		int to = 0;
+		for(int from = pages; from < oldPages; from++){
+			if(pageTable[from].free == TRUE) continue;
+			while(pageTable[to].free != TRUE) to++;
+			vmmMoveSecPage(from, to);
+		}
+	}
+
+	/* the page table grows before memory does and shrinks after it */
+	if(pages > oldPages){
+		PageTableRec *table = realloc(pageTable, pages * sizeof(PageTableRec));
+		if(table == NULL){
+			snprintf(error, 128, "out of memory");
+			return -1;
+		}
+		pageTable = table;
+		for(int page = oldPages; page < pages; page++){
+			memset(&pageTable[page], 0, sizeof(PageTableRec));
+			pageTable[page].free = TRUE;
+			pageTable[page].vPage = -1;
+			pageTable[page].mainPageFrame = -1;
+			pageTable[page].pageIn = -1;
+		}
+	}
+	if(vmmKernelSize(&secMem, createSecMem, getSecMemSize, getSecMemSize(), words) != 0){
+		snprintf(error, 128, "the kernel could not resize secondary memory");
+		return -1;
+	}
+	if(pages < oldPages){
+		/* a table that could not be given back is merely kept */
+		PageTableRec *table = realloc(pageTable, pages * sizeof(PageTableRec));
+		if(table != NULL) pageTable = table;
+	}
+	pageTableRecount();
+	if(VMEM_NOISE) printf("VMEM: secondary memory resized from %d to %d pages\n",oldPages,pages);
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmDropPage
+ *    map virtual page v of pid, in sPage, back to the zero page
+ *    without writing it back
+ */
+static void vmmDropPage(int pid, int v, int sPage){
+	pageTableSetDirty(sPage, FALSE);
+	if(pageTable[sPage].mainPageFrame != -1){
+		if(traceEnabled) traceEmit(TRACE_EVICT, pid, sPage, pageTable[sPage].mainPageFrame);
+		pageTablePageEvicted(pid, pageTable[sPage].mainPageFrame);
+	}
+	if(pageTable[sPage].pid != pid) return;
+	pageTable[sPage].pid = 0;
+	pageTable[sPage].vPage = -1;
+	pageTable[sPage].refs = 0;
+	pageTableSetFree(sPage, TRUE);
+	procTableSetPage(pid, v, vmmZeroPage);
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmAdvise
+ *    stack and heap come before the code in a process's virtual memory;
+ *    a page holding any code counts as a code page. pages after the
+ *    image (thread stacks) count as stack
+ */
+int vmmAdvise(int pid, WORD vAddr, WORD words, int advice){
+	int pSize = getPageSize();
+	Process *process = procTableFind(pid);
+	int *secPages;
+	int nPages = procTablePages(pid, &secPages);
+
+	if(process == NULL || advice < VMM_ADVICE_NORMAL || advice > VMM_ADVICE_SEQUENTIAL) return -1;
+	if(vAddr < 0 || words < 0 || vAddr + words > (WORD)nPages * pSize) return -1;
+	if(words == 0) return 0;
+
+	int first = vAddr / pSize;
+	int last = (vAddr + words - 1) / pSize;
+	WORD dataWords = process->stackSize + process->heapSize;
+	WORD imageWords = dataWords + process->codeSize;
+
+	if(advice == VMM_ADVICE_NORMAL){
+		vmmForgetSequential(pid, first, last);
+	}else if(advice == VMM_ADVICE_SEQUENTIAL){
+		vmmForgetSequential(pid, first, last);
+		vmmAddSequential(pid, first, last);
+	}else if(advice == VMM_ADVICE_WILLNEED){
+		int room = getNumMainPages() - 1;
+		for(int v = first; v <= last && room > 0; v++){
+			if(secPages[v] == vmmZeroPage) continue;
+			if(vmmPrefetch(pid, v, secPages[v], clock) == -1) break;
+			pageTable[secPages[v]].lastRef = clock;
+			room--;
+		}
+	}else{
+		for(int v = first; v <= last; v++){
+			int sPage = secPages[v];
+			if(sPage == vmmZeroPage || pageTable[sPage].pinned > 0) continue;
+			if((WORD)(v + 1) * pSize > dataWords && (WORD)v * pSize < imageWords){
+				if(pageTable[sPage].mainPageFrame != -1) vmmEvict(sPage);
+				continue;
+			}
+			/* the contents are dropped, not written back */
+			vmmDropPage(pid, v, sPage);
+		}
+	}
+	if(VMEM_NOISE) printf("VMEM: PID %d advised %d for vPages %d-%d\n",pid,advice,first,last);
+	return 0;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmAddPages
+ */
+WORD vmmAddPages(int pid, int pages){
+	int *secPages;
+	int nPages = procTablePages(pid, &secPages);
+
+	if(nPages == -1 || pages < 0) return -1;
+	for(int p = 0; p < pages; p++){
+		if(pageTableMapZeroPage(pid) != 0) return -1;
+	}
+	if(VMEM_NOISE) printf("VMEM: PID %d given vPages %d-%d\n",pid,nPages,nPages+pages-1);
+	return (WORD)nPages * getPageSize();
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * vmmDropPages
+ */
+void vmmDropPages(int pid, WORD vAddr, WORD words){
+	int pSize = getPageSize();
+	int *secPages;
+	int nPages = procTablePages(pid, &secPages);
+
+	if(pid == stackPid) vmmStackDrop();
+	for(int v = vAddr / pSize; v < nPages && (WORD)v * pSize < vAddr + words; v++){
+		int sPage = secPages[v];
+		if(sPage == vmmZeroPage || pageTable[sPage].pinned > 0) continue;
+		vmmDropPage(pid, v, sPage);
+	}
+}
+/*================================================================================*/
+
 /*================================================================================*/
 /*
  * readWordFromMainMem
@@ -303,43 +1375,7 @@ int pageTableFindLRUFrame(){
  * this is the only function that reads directly from mainMem[]
  */
 WORD readWordFromMainMem(WORD vAddr){
-	if(VMEM_NOISE) printf("READ\n");
-    if(VMEM_NOISE) printf("vmemnoise: reading vAddr: %ld\n", vAddr);
-    WORD pAddr;
-	int sPageOrigin,vpage,offset,freeMainPage;
-	
-	int found = -1;
-	for(int i = 0; i < getNumSecPages(); i++){
-		if(cpu.pid == pageTable[i].pid && found == -1){
-			//vpage = pageTable[i].vPage;
-			sPageOrigin=i;//new
-			found = 0;
-		}
-	}
-	
-	vpage = vAddr/getPageSize();
-	offset = vAddr%getPageSize();
-	
-	if(pageTable[sPageOrigin + vpage].mainPageFrame == -1){
-		//page fault
-		if(VMEM_NOISE) printf("PAGE FAULT\n");
-		freeMainPage = pageTableFindFreeMainPageFrame();
-		if(freeMainPage == -1){
-			//no free main page found, page replacement needed
-			if(VMEM_NOISE) printf("PAGE REPLACEMENT\n");
-			freeMainPage = pageReplacement();
-		}
-		//once a page is found, copy secondary page to main and calculate pAddr.
-		copySecToMain((sPageOrigin+vpage)*getPageSize(),freeMainPage*getPageSize(), getPageSize());
-		pageTableCopyToPageFrame((sPageOrigin+vpage),freeMainPage);
-		pAddr = (freeMainPage * getPageSize()) + offset;
-		
-	}else{
-		pAddr = (pageTable[sPageOrigin+vpage].mainPageFrame * getPageSize()) + offset;
-	}
-	if(VMEM_NOISE) printf("pAddr: %d\tvpage: %d\tfreemainpage: %d\tsPage: %d\n",pAddr,vpage,pageTable[sPageOrigin+vpage].mainPageFrame,(sPageOrigin+vpage));	
-	
-	return mainMem[pAddr];
+	return vmmPath->readWord(vAddr);
 }
 /*================================================================================*/
 
@@ -350,56 +1386,8 @@ WORD readWordFromMainMem(WORD vAddr){
  * 		0 on success
  *		-1 on failure
  */
-
 int writeWordToMainMem(WORD vAddr, WORD value){
-	if(VMEM_NOISE) printf("WRITE\n");
-	if(VMEM_NOISE) printf("vmemnoise: reading vAddr: %ld\n", vAddr);
-    
-	WORD pAddr;
-	int sPageOrigin,vpage,offset,freeMainPage;
-	int success = -1;
-	
-	int found = -1;
-	for(int i = 0; i < getNumSecPages(); i++){
-		if(cpu.pid == pageTable[i].pid && found == -1){
-			sPageOrigin=i;
-			found = 0;
-		}
-	}
-	
-	vpage = vAddr/getPageSize();
-	offset = vAddr%getPageSize();
-	
-	if(pageTable[sPageOrigin + vpage].mainPageFrame == -1){
-		//page fault
-		if(VMEM_NOISE) printf("PAGE FAULT\n");
-		freeMainPage = pageTableFindFreeMainPageFrame();
-		if(freeMainPage == -1){
-			//no free main page found, page replacement needed
-			if(VMEM_NOISE) printf("PAGE REPLACEMENT\n");
-			freeMainPage = pageReplacement();
-		}
-		//once a page is found, copy secondary page to main and calculate pAddr.
-		copySecToMain((sPageOrigin+vpage)*getPageSize(),freeMainPage*getPageSize(), getPageSize());
-		pageTableCopyToPageFrame((sPageOrigin+vpage),freeMainPage);
-		pAddr = (freeMainPage * getPageSize()) + offset;
-		
-	}else{
-		pAddr = (pageTable[sPageOrigin+vpage].mainPageFrame * getPageSize()) + offset;
-	}
-	if(VMEM_NOISE) printf("pAddr: %d\tvpage: %d\tfreemainpage: %d\tsPage: %d\n",pAddr,vpage,freeMainPage,(sPageOrigin+vpage));	
-	mainMem[pAddr] = value;
-
-	if(pAddr < 0 || pAddr >= getMainMemSize()){
-		fprintf(stderr, "seg fault in writeWordToMainMem\n");
-		exit(1);
-	}
-	
-	if(pAddr >= 0){
-		success =0;
-	}
-	
-	return success;
+	return vmmPath->writeWord(vAddr, value);
 }
 /*================================================================================*/
 
@@ -407,23 +1395,9 @@ int writeWordToMainMem(WORD vAddr, WORD value){
 /****Page Replacement Algo*************************************
 	pageReplacement is called when a page is not in main 
 	memory(AKA page fault) and finds a page using the Least 
-	Recently User(LRU) algorithm.
+	Recently User(LRU) algorithm. The victim is written back
+	if dirty and its main page frame is returned for reuse.
 **************************************************************/
 int pageReplacement(){
-	int returnPage;
-	int pageFound = -1;
-	//int last = -1;
-	
-	/* Find LRU Page */
-	for(int i = 0; i < getNumSecPages(); i++){
-		pageFound = pageTableFindLRUFrame();
-	}
-	
-	/*If the page found is dirty, write it back to secondary memory */
-	if(pageTable[pageFound].dirty == TRUE){
-		copyMainToSec(pageTable[pageFound].mainPageFrame*getPageSize(), pageTable[pageFound].vPage*getPageSize(), getPageSize());
-	}
-	
-	printf("page replacement found page %d in main\n",returnPage); 
-	return returnPage;
-}
\ No newline at end of file
+	return vmmPath->pageReplacement(cpu.pid);
+}
@@ -10,6 +10,7 @@
 
 #include "computer2.h"
 #include "fos-kernel2.h"
+#include "pageio.h"
 
 /*
  * PageTableRec - page table record
@@ -26,6 +27,12 @@
  *    mainPageFrame int       - the main mem page frame that has copy, if any
  *    dirty         int(bool) - has the main mem page frame been written to
  *    lastRef       int       - system clock time of last main page access
+ *    pinned        int       - pin count; a pinned page is never evicted
+ *    refs          int       - accesses since it came in, halved every
+ *                              migration epoch (its hotness, see tier.h)
+ *    pageIn        int       - the main mem page frame an asynchronous
+ *                              page-in is filling, -1 if none (the page
+ *                              is not mapped to it until the copy is done)
  */
 
 typedef struct {
@@ -35,10 +42,35 @@ typedef struct {
    int mainPageFrame;
    int dirty;
    int lastRef;
+   int pinned;
+   int refs;
+   int pageIn;
 } PageTableRec;
 
 PageTableRec *pageTable;
 
+/*
+ * VmmCounts - page table totals, kept up to date as records change so
+ * that a summary never scans the page table
+ *    free          secondary page frames that are free
+ *    freeExtents   runs of consecutive free frames
+ *    resident      frames with a copy in main memory
+ *    dirty         frames whose main memory copy was written to
+ * the same counts per process are kept in the process table
+ * (procTablePageCounts). code that sets free, mainPageFrame or dirty of
+ * a record directly, rather than through the pageTable* functions, must
+ * call pageTableRecount afterwards (moving a page between two main page
+ * frames changes no count)
+ */
+typedef struct {
+   int free;
+   int freeExtents;
+   int resident;
+   int dirty;
+} VmmCounts;
+
+extern VmmCounts vmmCounts;
+
 /*
  * the functions in this file fall under two categories:
  *   1. functions that access / update the pageTable
@@ -64,8 +96,8 @@ int initVMM();
 
 /*
  * pageTableGetFreeSecPage
- *    search the pageTable for a free secondary page
- *    find the first entry where free == TRUE
+ *    take a free secondary page off the free list (the lowest one,
+ *    until frames are given back)
  *    the index of the entry is also the secondary page number
  *
  *    return
@@ -79,13 +111,60 @@ int pageTableGetFreeSecPage();
  *    this does not do the loading (done in kernel)
  *    this records in the page frame that a page of a process
  *    has been loaded in secondary memory
+ *    the frame becomes the next virtual page of pid, which must be
+ *    registered in the process table (procTableAdd)
  *
  * return
  *    0 success
- *    -1 failure (secondary page is already occupied)
+ *    -1 failure (bad frame or unknown pid)
  */
 int pageTableLoadProcessToSecFrame(int sPageFrame, int pid);
 
+/*
+ * pageTableReserveSecPages
+ *    reserve pages free secondary page frames, wherever they are, into
+ *    frames[0..pages-1]; the frames stop being free but belong to no
+ *    process yet
+ *
+ *    return
+ *       0 success
+ *       -1 failure (fewer free frames than that, none are reserved)
+ */
+int pageTableReserveSecPages(int pages, int frames[]);
+
+/*
+ * vmmZeroPage - the shared zero page
+ *    a secondary page frame of zeros, reserved by initVMM and owned by
+ *    no process (pid 0). untouched stack and heap pages of every process
+ *    map to it; the first write to one gives the process its own frame
+ *    (zero fill on demand). vmmZeroFills counts those writes
+ */
+extern int vmmZeroPage;
+extern long vmmZeroFills;
+
+/*
+ * pageTableMapZeroPage
+ *    map the next virtual page of pid to the shared zero page
+ *
+ *    return
+ *       0 success
+ *       -1 failure (unknown pid)
+ */
+int pageTableMapZeroPage(int pid);
+
+/*
+ * pageTableReleaseSecPages
+ *    give back frames reserved by pageTableReserveSecPages
+ */
+void pageTableReleaseSecPages(int frames[], int pages);
+
+/*
+ * pageTableCommitSecPages
+ *    record that process pid was loaded into the reserved frames
+ *    frames[0..pages-1]; they become its next virtual pages, in order
+ */
+void pageTableCommitSecPages(int frames[], int pages, int pid);
+
 /*
  * pageTableAccessPageFrame
  *    update the pageTable with last access time
@@ -104,6 +183,7 @@ int pageTableAccessPageFrame(int mPageFrame, int write);
 /*
  * pageTableProcessTerm
  *    update the pageTable to reflect that a process has terminated
+ *    only the frames of pid are visited (the process table keeps them)
  *
  *    return
  *       void
@@ -111,6 +191,19 @@ int pageTableAccessPageFrame(int mPageFrame, int write);
 
 void pageTableProcessTerm(int pid);
 
+/*
+ * pageTableRecount
+ *    recompute vmmCounts and the per process counts from the page table
+ */
+void pageTableRecount();
+
+/*
+ * pageTableChecksum
+ *    a hash of every field of every page table record
+ *    two runs that did the same paging have the same checksum
+ */
+unsigned long pageTableChecksum();
+
 /*
  * pageTableCopyToPageFrame
  *    update the pageTable to reflect that a page has been (or will be)
@@ -152,6 +245,7 @@ int pageTableFindFreeMainPageFrame();
 /*
  * pageTableFindLRUFrame
  *    find the main memory page frame used least recently
+ *    pinned pages are skipped
  *
  *    return
  *       a secondary page frame number that corresponds to LRU main page frame
@@ -177,4 +271,268 @@ WORD readWordFromMainMem(WORD vAddr);
  */
 int writeWordToMainMem(WORD vAddr, WORD value);
 int pageReplacement();
+
+/*
+ * VmmPathOps - one build of the read/write/fault path (see vmmpath.h)
+ *    the lean build has every diagnostic compiled out
+ *    the instrumented build honors vmem noise, the profiler and tracing
+ */
+typedef struct {
+   WORD (*translate)(int pid, WORD vAddr, int write);
+   WORD (*readWord)(WORD vAddr);
+   int (*writeWord)(WORD vAddr, WORD value);
+   int (*pageReplacement)(int pid);
+} VmmPathOps;
+
+extern VmmPathOps *vmmPath;
+
+/*
+ * vmmSelectPath
+ *    point vmmPath at the instrumented build if vmem noise, the profiler
+ *    or tracing is on, otherwise at the lean build
+ *    call this after any of them is toggled
+ *
+ *    return
+ *       1 instrumented, 0 lean
+ */
+int vmmSelectPath();
+
+/*
+ * vmmReadHook / vmmFaultHook - set by the scheduler while it runs a
+ * process with asynchronous page faults (NULL otherwise)
+ *    vmmReadHook is called after every word read by the cpu path
+ *    vmmFaultHook is called when translating vAddr of pid (for a write
+ *    if write is set) finds sPage missing from main memory; if it returns, the fault is handled
+ *    synchronously as usual, unless the hook has brought the page in.
+ *    a page being paged in (pageIn != -1) is only ever translated with
+ *    the hook set, which waits for it
+ */
+typedef void (*VmmReadHook)(WORD vAddr, WORD word);
+typedef void (*VmmFaultHook)(int pid, WORD vAddr, int sPage, int write);
+
+extern VmmReadHook vmmReadHook;
+extern VmmFaultHook vmmFaultHook;
+
+/*
+ * vmmBusErrorHook - set by the scheduler while it runs a process
+ *    called when the process touches memory outside itself, or writes
+ *    to a page secondary memory has no room for; it does not return
+ *    (the process ends in BUS_ERROR, FOS goes on). with no hook set
+ *    FOS exits
+ */
+typedef void (*VmmBusErrorHook)();
+
+extern VmmBusErrorHook vmmBusErrorHook;
+
+/*
+ * vmmLastRead - vAddr of the last word read by the cpu path
+ *    (readWordFromMainMem). the cpu stops with BAD_INSTR right after
+ *    fetching an instruction it does not know, so then this is where
+ *    that instruction is (xinstExecute)
+ */
+extern WORD vmmLastRead;
+
+/*
+ * vmmPageInAsync
+ *    start bringing secondary page sPage into main memory on the I/O
+ *    worker. a free frame is used, or the LRU page is evicted; a dirty
+ *    victim is written back by the same job. the frame is reserved for
+ *    sPage (pageIn) and sPage is pinned at once, so no other fault can
+ *    take either, but sPage stays unmapped until vmmPageInDone: until
+ *    then the frame may still hold the victim's words
+ *
+ *    frame - set to the frame the job fills
+ *    writeBack - set TRUE if the job writes a victim back
+ *
+ *    return
+ *       the job; pageioWait for it, then call vmmPageInDone
+ *       NULL if every main page frame is pinned
+ */
+PageioJob* vmmPageInAsync(int sPage, int *frame, int *writeBack);
+
+/*
+ * vmmPageInDone
+ *    record that the page-in of sPage into frame has landed: map it
+ *    the page stays pinned until vmmUnpinPage
+ */
+void vmmPageInDone(int sPage, int frame);
+
+/*
+ * vmmUnpinPage
+ *    drop one pin of sPage (no-op if it is not pinned)
+ */
+void vmmUnpinPage(int sPage);
+
+/*
+ * vmmCopySecToMain / vmmCopyMainToSec
+ *    same contract as copySecToMain / copyMainToSec in computer2.h,
+ *    done as one memcpy instead of word by word
+ *
+ *    return
+ *       0 success
+ *       -1 failure (range outside memory)
+ */
+int vmmCopySecToMain(int sStart, int mStart, int words);
+int vmmCopyMainToSec(int mStart, int sStart, int words);
+
+/*
+ * vmmTranslate
+ *    physical address in mainMem of vAddr of the running process,
+ *    faulting the page in if needed (charged as one access)
+ */
+WORD vmmTranslate(WORD vAddr, int write);
+
+/*
+ * vmmBlockCopy
+ *    copy words from srcV to dstV of the running process, translating
+ *    once per page span instead of once per word; overlapping ranges
+ *    are copied as if through a temporary buffer
+ *
+ * vmmBlockFill
+ *    set words starting at dstV to value, translating once per page span
+ *
+ *    return
+ *       0 success
+ */
+int vmmBlockCopy(WORD srcV, WORD dstV, WORD words);
+int vmmBlockFill(WORD dstV, WORD value, WORD words);
+
+/*
+ * the stack window - the stack page the running process (or thread)
+ * used last (PUSH, POP, GOSU and RETU go through readWordFromMainMem
+ * and writeWordToMainMem at cpu.sp) is pinned in main memory, and an access
+ * that falls in it is an offset from its frame: no page map lookup and
+ * no fault check, only the same reference, dirty and cost bookkeeping
+ * as a translation. the window moves on the first access to another
+ * stack page, and is dropped when another process accesses memory,
+ * when its process ends and before memory is resized. the stack page
+ * of the running process is never the victim of page replacement
+ * while any other page can be
+ *
+ * vmmStackHits counts accesses that went through the window,
+ * vmmStackMoves the times it moved to another page
+ */
+extern long vmmStackHits;
+extern long vmmStackMoves;
+
+/*
+ * vmmStackDrop
+ *    unpin the stack window (for code that changes the page table
+ *    behind the vmm's back, e.g. the benchmarks)
+ */
+void vmmStackDrop();
+
+/*
+ * VmmSpan - a piece of a pinned virtual range that is contiguous in mainMem
+ *    vAddr    first virtual address of the span
+ *    pAddr    where that word is in mainMem
+ *    words    length of the span
+ *    sPage    secondary page frame backing it (used to unpin)
+ */
+typedef struct {
+   WORD vAddr;
+   WORD pAddr;
+   WORD words;
+   int sPage;
+} VmmSpan;
+
+/*
+ * vmmPinRange
+ *    fault [vAddr, vAddr + words) of process pid into main memory once and
+ *    pin it there, so the caller can read (or, if write, write) mainMem
+ *    directly at each span's pAddr until vmmUnpinRange
+ *
+ *    parameters
+ *       spans - filled with one span per page, in address order
+ *       maxSpans - size of spans
+ *
+ *    return
+ *       number of spans
+ *       -1 failure (range outside the process, more spans than maxSpans,
+ *          or not enough unpinned main page frames)
+ */
+int vmmPinRange(int pid, WORD vAddr, WORD words, int write, VmmSpan spans[], int maxSpans);
+
+/*
+ * vmmUnpinRange
+ *    release the pages pinned by vmmPinRange
+ */
+void vmmUnpinRange(VmmSpan spans[], int nSpans);
+
+/*
+ * vmmDump
+ *    print words of process pid starting at vAddr, pinning the range at
+ *    most VMM_DUMP_SPANS pages at a time
+ *    return 0 success, -1 failure
+ */
+int vmmDump(int pid, WORD vAddr, WORD words);
+
+#define VMM_DUMP_SPANS 16
+
+/*
+ * vmmResizeMain / vmmResizeSec
+ *    change the size of main or secondary memory to words (a multiple
+ *    of the page size) while processes are loaded; call only between
+ *    quanta, with no page-ins in flight
+ *    shrinking main memory evicts the pages in the frames that go away
+ *    (writing dirty ones back, as page replacement does), and fails if
+ *    one of them is pinned. shrinking secondary memory moves the pages
+ *    past the new end into free frames, and fails if they do not fit
+ *
+ *    return
+ *       0 success
+ *       -1 failure (error says why; the size is unchanged)
+ */
+int vmmResizeMain(int words, char error[128]);
+int vmmResizeSec(int words, char error[128]);
+
+/*
+ * memory advice - what a process says it will do with a range of its
+ * virtual memory (the ADVS extended instruction, xinst.c)
+ *    NORMAL      forget earlier SEQUENTIAL advice for the range
+ *    WILLNEED    read the range into main memory now (up to all but one
+ *                main page frame of it)
+ *    DONTNEED    drop the range from main memory without writing it
+ *                back; stack and heap pages go back to the zero page
+ *                (they read as zeros), code pages are only evicted
+ *    SEQUENTIAL  a synchronous fault in the range also reads in the
+ *                next VMM_READAHEAD pages of it, and makes the pages
+ *                more than one behind it the first to be replaced
+ * pinned pages are left alone. pages read in ahead of use are charged
+ * as secondary reads (costChargePrefetch), not as faults
+ */
+#define VMM_ADVICE_NORMAL 0
+#define VMM_ADVICE_WILLNEED 1
+#define VMM_ADVICE_DONTNEED 2
+#define VMM_ADVICE_SEQUENTIAL 3
+
+#define VMM_READAHEAD 4
+
+/*
+ * vmmAdvise
+ *    take advice about [vAddr, vAddr + words) of process pid
+ *
+ *    return
+ *       0 success
+ *       -1 failure (unknown pid or advice, range outside the process)
+ */
+int vmmAdvise(int pid, WORD vAddr, WORD words, int advice);
+
+/*
+ * vmmAddPages
+ *    give process pid pages more virtual pages after the ones it has,
+ *    mapped to the zero page (the stack of a thread, see thread.h)
+ *
+ *    return
+ *       the virtual address of the first new page
+ *       -1 failure (no such pid, out of memory)
+ */
+WORD vmmAddPages(int pid, int pages);
+
+/*
+ * vmmDropPages
+ *    give the pages of [vAddr, vAddr + words) of pid back to the zero
+ *    page, dropping their contents (pinned pages are left alone)
+ */
+void vmmDropPages(int pid, WORD vAddr, WORD words);
 #endif
@@ -0,0 +1,198 @@
+/*
+ * vmmpath.h
+ * translation, fault and access path of the vmm
+ * Joshua Castelli/Nathan Helmig
+ *
+ * this file is included twice by vmm.c (there is no include guard):
+ *    VMM_INSTRUMENTED 0, VMM_PATH(name) name##Lean  - no diagnostics at all
+ *    VMM_INSTRUMENTED 1, VMM_PATH(name) name##Instr - noise, profiler, trace
+ * vmmSelectPath points vmmPath at one of the two builds
+ *
+ * everything that changes simulated state (page table, cost model)
+ * must be outside the #if VMM_INSTRUMENTED blocks so that both builds
+ * behave the same
+ */
+
+/*================================================================================*/
+/*
+ * VMM_PATH(pageReplacement)
+ *    find the LRU page, write it back if dirty, evict it
+ *    pid - the faulting process, which is charged for the write-back
+ *    return - the main page frame that is now free
+ */
+static int VMM_PATH(pageReplacement)(int pid){
+	int returnPage;
+	int pageFound;
+
+	/* Find LRU Page; the stack window gives way only if nothing else can */
+	pageFound = pageTableFindLRUFrame();
+	if(pageFound == -1){
+		vmmStackDrop();
+		pageFound = pageTableFindLRUFrame();
+	}
+	if(pageFound == -1){
+		fprintf(stderr, "page replacement found no page in main\n");
+		exit(1);
+	}
+	returnPage = pageTable[pageFound].mainPageFrame;
+
+	/*If the page found is dirty, write it back to secondary memory */
+	if(pageTable[pageFound].dirty == TRUE){
+		vmmCopyMainToSec(returnPage*getPageSize(), pageFound*getPageSize(), getPageSize());
+		costChargeWriteBack(pid, getPageSize());
+#if VMM_INSTRUMENTED
+		if(traceEnabled) traceEmit(TRACE_WRITEBACK, pageTable[pageFound].pid, pageFound, returnPage);
+#endif
+		pageTableSetDirty(pageFound, FALSE);
+	}
+#if VMM_INSTRUMENTED
+	if(traceEnabled) traceEmit(TRACE_EVICT, pageTable[pageFound].pid, pageFound, returnPage);
+#endif
+	pageTablePageEvicted(pageTable[pageFound].pid, returnPage);
+
+#if VMM_INSTRUMENTED
+	if(VMEM_NOISE) printf("page replacement found page %d in main\n",returnPage);
+#endif
+	return returnPage;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * VMM_PATH(translate)
+ *    convert vAddr of process pid to a physical address,
+ *    faulting the page into main memory if it is not there
+ *    the access itself is charged by the caller (the cache model may
+ *    take it instead)
+ *
+ *    write (boolean) - the access will write the word
+ *    return - the physical address in mainMem
+ */
+static WORD VMM_PATH(translate)(int pid, WORD vAddr, int write){
+	WORD pAddr;
+	int vpage,offset,sPage,freeMainPage;
+	int words = getPageSize();
+	int faulted = FALSE;
+
+	vpage = vAddr/getPageSize();
+	offset = vAddr%getPageSize();
+	sPage = vmmSecPage(pid, vpage);
+	if(vAddr < 0 || sPage == -1){
+		fprintf(stderr, "seg fault: PID %d vAddr %ld is outside the process\n", pid, vAddr);
+		vmmBusError(pid);
+	}
+
+	/* reads of an untouched page see the zero page, the first write copies it */
+	if(sPage == vmmZeroPage && write){
+		sPage = vmmZeroFill(pid, vpage);
+		words = 0;
+	}
+
+	if(pageTable[sPage].mainPageFrame == -1){
+		//page fault
+#if VMM_INSTRUMENTED
+		if(VMEM_NOISE) printf("PAGE FAULT\n");
+		if(profEnabled && pid == cpu.pid) profNoteFault(pid, vAddr, cpu.pc);
+		if(traceEnabled) traceEmit(TRACE_FAULT, pid, vpage, sPage);
+#endif
+		/*
+		 * the scheduler may block the process instead (does not return),
+		 * or wait for a page-in of sPage already under way
+		 */
+		if(vmmFaultHook != NULL) vmmFaultHook(pid, vAddr, sPage, write);
+	}
+	if(pageTable[sPage].mainPageFrame == -1){
+		/* a zero filled page is not read from secondary memory */
+		costChargeFault(pid, words);
+		freeMainPage = pageTableFindFreeMainPageFrame();
+		if(freeMainPage == -1){
+			//no free main page found, page replacement needed
+#if VMM_INSTRUMENTED
+			if(VMEM_NOISE) printf("PAGE REPLACEMENT\n");
+#endif
+			freeMainPage = VMM_PATH(pageReplacement)(pid);
+		}
+		//once a page is found, copy secondary page to main
+		vmmCopySecToMain(sPage*getPageSize(),freeMainPage*getPageSize(), getPageSize());
+		pageTableCopyToPageFrame(sPage,freeMainPage);
+		faulted = TRUE;
+	}
+	pAddr = (pageTable[sPage].mainPageFrame * getPageSize()) + offset;
+#if VMM_INSTRUMENTED
+	if(VMEM_NOISE) printf("pAddr: %ld\tvpage: %d\tmainpage: %d\tsPage: %d\n",pAddr,vpage,pageTable[sPage].mainPageFrame,sPage);
+#endif
+
+	/* same bookkeeping as pageTableAccessPageFrame, without searching for the frame */
+	pageTable[sPage].lastRef = clock;
+	pageTable[sPage].refs++;
+	if(write && pageTable[sPage].dirty != TRUE) pageTableSetDirty(sPage, TRUE);
+
+	/* read-ahead for SEQUENTIAL advice (vmmAdvise) */
+	if(faulted && nSeqRanges > 0) vmmSequentialFault(pid, vpage);
+
+	return pAddr;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * VMM_PATH(readWord) - see readWordFromMainMem
+ */
+static WORD VMM_PATH(readWord)(WORD vAddr){
+#if VMM_INSTRUMENTED
+	if(VMEM_NOISE) printf("READ\n");
+	if(VMEM_NOISE) printf("vmemnoise: reading vAddr: %ld\n", vAddr);
+#endif
+	WORD pAddr = vmmStackAccess(cpu.pid, vAddr, FALSE);
+	if(pAddr == -1){
+		pAddr = VMM_PATH(translate)(cpu.pid, vAddr, FALSE);
+		vmmStackMove(cpu.pid, vAddr, pAddr);
+	}
+#if VMM_INSTRUMENTED
+	if(profEnabled) profNoteRead(cpu.pid, vAddr, cpu.pc, mainMem[pAddr]);
+#endif
+	if(cacheEnabled){
+		cacheAccess(vAddr == cpu.pc ? CACHE_I : CACHE_D, cpu.pid, pAddr, FALSE);
+	}else{
+		vmmChargeAccesses(cpu.pid, pAddr, 1);
+	}
+	if(vmmReadHook != NULL) vmmReadHook(vAddr, mainMem[pAddr]);
+	vmmLastRead = vAddr;
+	return mainMem[pAddr];
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * VMM_PATH(writeWord) - see writeWordToMainMem
+ */
+static int VMM_PATH(writeWord)(WORD vAddr, WORD value){
+#if VMM_INSTRUMENTED
+	if(VMEM_NOISE) printf("WRITE\n");
+	if(VMEM_NOISE) printf("vmemnoise: writing vAddr: %ld\n", vAddr);
+#endif
+	WORD pAddr = vmmStackAccess(cpu.pid, vAddr, TRUE);
+	if(pAddr == -1){
+		pAddr = VMM_PATH(translate)(cpu.pid, vAddr, TRUE);
+		vmmStackMove(cpu.pid, vAddr, pAddr);
+	}
+	if(pAddr < 0 || pAddr >= getMainMemSize()){
+		fprintf(stderr, "seg fault in writeWordToMainMem\n");
+		vmmBusError(cpu.pid);
+	}
+	if(cacheEnabled){
+		cacheAccess(CACHE_D, cpu.pid, pAddr, TRUE);
+	}else{
+		vmmChargeAccesses(cpu.pid, pAddr, 1);
+	}
+	mainMem[pAddr] = value;
+	return 0;
+}
+/*================================================================================*/
+
+VmmPathOps VMM_PATH(vmmPathOps) = {
+	VMM_PATH(translate),
+	VMM_PATH(readWord),
+	VMM_PATH(writeWord),
+	VMM_PATH(pageReplacement)
+};
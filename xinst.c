@@ -0,0 +1,93 @@
+/*
+ * xinst.c
+ * extended instructions for fos os
+ * Joshua Castelli/Nathan Helmig
+ */
+
+#include "xinst.h"
+#include "vmm.h"
+#include "thread.h"
+#include <stdio.h>
+
+/*================================================================================*/
+/*
+ * xinstReg
+ *    register number of an instruction operand character
+ *    return: 0-9, or -1 if c is not a register
+ */
+static int xinstReg(char c){
+	if(c < '0' || c > '9') return -1;
+	return c - '0';
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * xinstInRange
+ *    is [vAddr, vAddr + words) inside the process image
+ */
+static int xinstInRange(Process *process, WORD vAddr, WORD words){
+	WORD size = process->stackSize + process->heapSize + process->codeSize;
+	return vAddr >= 0 && words >= 0 && vAddr + words <= size;
+}
+/*================================================================================*/
+
+/*================================================================================*/
+/*
+ * xinstExecute
+ *    the cpu may or may not have moved pc past the rejected instruction
+ *    before giving up; it was the last word the cpu read (vmmLastRead),
+ *    so the process goes on after that
+ */
+int xinstExecute(Process *process){
+	FriscCPU *c = &process->cpu;
+	char op = c->inst.s[0];
+	int a, b, n;
+
+	if(op != BMOV && op != BFIL && op != ADVS && op != SPWN && op != JOIN) return -1;
+
+	a = xinstReg(c->inst.s[1]);
+	b = xinstReg(c->inst.s[2]);
+	n = op == SPWN || op == JOIN ? 0 : xinstReg(c->inst.s[3]);
+	if(a == -1 || b == -1 || n == -1){
+		fprintf(stderr, "PID %d: bad register in extended instruction %.4s\n", process->pid, c->inst.s);
+		return -1;
+	}
+
+	c->pc = vmmLastRead + 1;
+
+	if(op == SPWN){
+		WORD codeStart = process->stackSize + process->heapSize;
+		if(c->reg[a] < codeStart || !xinstInRange(process, c->reg[a], 1) || threadSpawn(process, c->reg[a], b) != 0){
+			fprintf(stderr, "PID %d: cannot start a thread at %ld\n", process->pid, c->reg[a]);
+			return -1;
+		}
+	}else if(op == JOIN){
+		int joined = threadJoin(process, c->reg[a], b);
+		if(joined == -1){
+			fprintf(stderr, "PID %d: no thread %ld to join at %ld\n", process->pid, c->reg[a], c->pc - 1);
+			return -1;
+		}
+		if(joined == 1) return XINST_WAIT;
+	}else if(op == BMOV){
+		if(!xinstInRange(process, c->reg[a], c->reg[n]) || !xinstInRange(process, c->reg[b], c->reg[n])){
+			fprintf(stderr, "PID %d: block move outside process at %ld\n", process->pid, c->pc - 1);
+			return -1;
+		}
+		vmmBlockCopy(c->reg[a], c->reg[b], c->reg[n]);
+	}else if(op == ADVS){
+		/* the last character is the hint itself, not a register */
+		if(!xinstInRange(process, c->reg[a], c->reg[b]) || vmmAdvise(process->pid, c->reg[a], c->reg[b], n) != 0){
+			fprintf(stderr, "PID %d: bad memory advice at %ld\n", process->pid, c->pc - 1);
+			return -1;
+		}
+	}else{
+		if(!xinstInRange(process, c->reg[a], c->reg[n])){
+			fprintf(stderr, "PID %d: block fill outside process at %ld\n", process->pid, c->pc - 1);
+			return -1;
+		}
+		vmmBlockFill(c->reg[a], c->reg[b], c->reg[n]);
+	}
+	return 0;
+}
+/*================================================================================*/
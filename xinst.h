@@ -0,0 +1,34 @@
+/*
+ * xinst.h
+ * extended instructions for fos os
+ * Joshua Castelli/Nathan Helmig
+ *
+ * the cpu (runCPU) only knows the opcodes of frisc2.h and stops with
+ * BAD_INSTR on anything else. the os traps that, and if the rejected
+ * instruction is one of the extended opcodes (BMOV, BFIL, ADVS, ...) it is
+ * emulated here and the process carries on as if the cpu had run it
+ * (SPWN and JOIN are the thread instructions, see thread.h)
+ */
+
+#ifndef XINST_H
+#define XINST_H
+
+#include "computer2.h"
+#include "fos-kernel2.h"
+
+/*
+ * xinstExecute
+ *    emulate the instruction in process->cpu.inst
+ *    call after saveProcessState, with cpu.pid still the process's pid
+ *
+ *    return
+ *       0 emulated, process->cpu has been advanced past the instruction
+ *       XINST_WAIT as 0, but the process waits (a JOIN), it must not
+ *          run until it is woken
+ *       -1 not an extended instruction, or its operands are bad
+ */
+#define XINST_WAIT 1
+
+int xinstExecute(Process *process);
+
+#endif